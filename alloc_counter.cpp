@@ -0,0 +1,129 @@
+#include "alloc_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace alloc_counter {
+namespace {
+thread_local counts* active = nullptr;
+thread_local guard* innermost = nullptr;
+
+void* allocate(std::size_t size) {
+  if (active != nullptr) {
+    ++active->allocations;
+    active->bytes += size;
+  }
+  void* result = std::malloc(size == 0 ? 1 : size);
+  if (result == nullptr) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+void* allocate(std::size_t size, std::align_val_t align) {
+  if (active != nullptr) {
+    ++active->allocations;
+    active->bytes += size;
+  }
+  auto alignment = static_cast<std::size_t>(align);
+  std::size_t rounded = (size + alignment - 1) / alignment * alignment;
+  void* result =
+      std::aligned_alloc(alignment, rounded == 0 ? alignment : rounded);
+  if (result == nullptr) {
+    throw std::bad_alloc();
+  }
+  return result;
+}
+
+void deallocate(void* ptr) noexcept {
+  if (ptr == nullptr) {
+    return;
+  }
+  if (active != nullptr) {
+    ++active->deallocations;
+  }
+  std::free(ptr);
+}
+} // namespace
+
+guard::guard() noexcept : outer(innermost) {
+  innermost = this;
+  active = &current;
+}
+
+guard::~guard() {
+  innermost = outer;
+  if (outer != nullptr) {
+    outer->current.allocations += current.allocations;
+    outer->current.deallocations += current.deallocations;
+    outer->current.bytes += current.bytes;
+    active = &outer->current;
+  } else {
+    active = nullptr;
+  }
+}
+} // namespace alloc_counter
+
+void* operator new(std::size_t size) {
+  return alloc_counter::allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+  return alloc_counter::allocate(size);
+}
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept {
+  try {
+    return alloc_counter::allocate(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept {
+  try {
+    return alloc_counter::allocate(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+  return alloc_counter::allocate(size, align);
+}
+
+void* operator new[](std::size_t size, std::align_val_t align) {
+  return alloc_counter::allocate(size, align);
+}
+
+void operator delete(void* ptr) noexcept {
+  alloc_counter::deallocate(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  alloc_counter::deallocate(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+  alloc_counter::deallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+  alloc_counter::deallocate(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+  alloc_counter::deallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+  alloc_counter::deallocate(ptr);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+  alloc_counter::deallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+  alloc_counter::deallocate(ptr);
+}
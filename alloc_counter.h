@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+
+// Counts calls to the global allocation functions made by the current
+// thread while a guard is alive. The replacement operators live in
+// alloc_counter.cpp, which has to be linked into the executable.
+namespace alloc_counter {
+
+struct counts {
+  std::size_t allocations{0};
+  std::size_t deallocations{0};
+  std::size_t bytes{0};
+};
+
+class guard {
+public:
+  guard() noexcept;
+
+  guard(guard const&) = delete;
+  guard& operator=(guard const&) = delete;
+
+  // Nested guards also report their counts to the enclosing one
+  ~guard();
+
+  std::size_t allocations() const noexcept {
+    return current.allocations;
+  }
+
+  std::size_t deallocations() const noexcept {
+    return current.deallocations;
+  }
+
+  std::size_t bytes() const noexcept {
+    return current.bytes;
+  }
+
+  void reset() noexcept {
+    current = {};
+  }
+
+private:
+  counts current;
+  guard* outer;
+};
+} // namespace alloc_counter
@@ -0,0 +1,244 @@
+#include "alloc_counter.h"
+#include "function.h"
+#include <gtest/gtest.h>
+
+namespace {
+struct small_target {
+  int operator()() const {
+    return 42;
+  }
+
+  int value{0};
+};
+
+struct large_target {
+  int operator()() const {
+    return 42;
+  }
+
+  int payload[64]{};
+};
+
+struct throwing_move_target {
+  throwing_move_target() = default;
+  throwing_move_target(throwing_move_target const&) = default;
+
+  throwing_move_target(throwing_move_target&&) noexcept(false) {}
+
+  int operator()() const {
+    return 42;
+  }
+};
+
+static_assert(function_impl::fits_small<small_target>);
+static_assert(!function_impl::fits_small<large_target>);
+static_assert(!function_impl::fits_small<throwing_move_target>);
+
+// Keeps the optimizer from eliding new/delete pairs of objects whose
+// lifetime is fully visible to it
+template <typename T>
+void escape(T& value) {
+#if defined(__GNUC__)
+  asm volatile("" : : "r"(&value) : "memory");
+#else
+  static_cast<void>(value);
+#endif
+}
+
+template <typename T>
+struct allocation_test : testing::Test {};
+
+// Number of heap allocations a single stored T costs
+template <typename T>
+constexpr std::size_t expected_allocations =
+    function_impl::fits_small<T> ? 0 : 1;
+
+using targets =
+    testing::Types<small_target, large_target, throwing_move_target>;
+TYPED_TEST_SUITE(allocation_test, targets);
+} // namespace
+
+TEST(allocation_test, guard_counts) {
+  alloc_counter::guard outer;
+  {
+    alloc_counter::guard inner;
+    // Called directly, as new-expressions may be elided by the optimizer
+    ::operator delete(::operator new(sizeof(int)));
+    EXPECT_EQ(1, inner.allocations());
+    EXPECT_EQ(1, inner.deallocations());
+    EXPECT_EQ(sizeof(int), inner.bytes());
+  }
+  EXPECT_EQ(1, outer.allocations());
+  EXPECT_EQ(1, outer.deallocations());
+}
+
+TEST(allocation_test, empty) {
+  alloc_counter::guard guard;
+  function<int()> f;
+  function<int()> g = f;
+  function<int()> h = std::move(f);
+  g = h;
+  h = std::move(g);
+  f.swap(h);
+  EXPECT_EQ(0, guard.allocations());
+  EXPECT_EQ(0, guard.deallocations());
+}
+
+TEST(allocation_test, function_pointer) {
+  alloc_counter::guard guard;
+  function<int()> f = +[] { return 42; };
+  function<int()> g = f;
+  escape(g);
+  EXPECT_EQ(42, g());
+  EXPECT_EQ(0, guard.allocations());
+}
+
+TYPED_TEST(allocation_test, construct) {
+  alloc_counter::guard guard;
+  {
+    function<int()> f = TypeParam();
+    escape(f);
+    EXPECT_EQ(expected_allocations<TypeParam>, guard.allocations());
+  }
+  EXPECT_EQ(guard.allocations(), guard.deallocations());
+}
+
+TYPED_TEST(allocation_test, copy) {
+  function<int()> f = TypeParam();
+  alloc_counter::guard guard;
+  {
+    function<int()> g = f;
+    escape(g);
+    EXPECT_EQ(expected_allocations<TypeParam>, guard.allocations());
+  }
+  EXPECT_EQ(guard.allocations(), guard.deallocations());
+}
+
+TYPED_TEST(allocation_test, move) {
+  function<int()> f = TypeParam();
+  alloc_counter::guard guard;
+  function<int()> g = std::move(f);
+  EXPECT_EQ(0, guard.allocations());
+  EXPECT_EQ(0, guard.deallocations());
+}
+
+TYPED_TEST(allocation_test, swap) {
+  function<int()> f = TypeParam();
+  function<int()> g = small_target();
+  function<int()> h = large_target();
+  alloc_counter::guard guard;
+  f.swap(g);
+  g.swap(h);
+  h.swap(f);
+  EXPECT_EQ(0, guard.allocations());
+  EXPECT_EQ(0, guard.deallocations());
+}
+
+TYPED_TEST(allocation_test, copy_assign) {
+  function<int()> f = TypeParam();
+  function<int()> g = large_target();
+  alloc_counter::guard guard;
+  g = f;
+  escape(g);
+  EXPECT_EQ(expected_allocations<TypeParam>, guard.allocations());
+  // The previous large target of g is released
+  EXPECT_EQ(1, guard.deallocations());
+}
+
+TYPED_TEST(allocation_test, move_assign) {
+  function<int()> f = TypeParam();
+  function<int()> g = large_target();
+  alloc_counter::guard guard;
+  g = std::move(f);
+  EXPECT_EQ(0, guard.allocations());
+  EXPECT_EQ(1, guard.deallocations());
+}
+
+TYPED_TEST(allocation_test, move_assign_from_own_target) {
+  struct holder {
+    int operator()() {
+      return inner();
+    }
+
+    function<int()> inner;
+  };
+  function<int()> f = holder{TypeParam()};
+  alloc_counter::guard guard;
+  f = std::move(f.target<holder>()->inner);
+  escape(f);
+  EXPECT_EQ(42, f());
+  EXPECT_EQ(0, guard.allocations());
+  // Only the holder is released, the inner target is taken over
+  EXPECT_EQ(1, guard.deallocations());
+}
+
+TYPED_TEST(allocation_test, invoke) {
+  function<int()> f = TypeParam();
+  alloc_counter::guard guard;
+  int sum = 0;
+  for (int i = 0; i < 100; ++i) {
+    sum += f();
+  }
+  EXPECT_EQ(4200, sum);
+  EXPECT_EQ(0, guard.allocations());
+  EXPECT_EQ(0, guard.deallocations());
+}
+
+TYPED_TEST(allocation_test, target) {
+  function<int()> f = TypeParam();
+  alloc_counter::guard guard;
+  EXPECT_NE(nullptr, f.template target<TypeParam>());
+  EXPECT_EQ(0, guard.allocations());
+}
+
+TYPED_TEST(allocation_test, release_c_callback) {
+  function<int()> f = TypeParam();
+  alloc_counter::guard guard;
+  auto callback = std::move(f).release_c_callback();
+  EXPECT_EQ(0, guard.allocations());
+  EXPECT_EQ(42, callback());
+  EXPECT_EQ(0, guard.allocations());
+  EXPECT_EQ(expected_allocations<TypeParam>, guard.deallocations());
+}
+
+TEST(allocation_test, function_view) {
+  function<int()> f = large_target();
+  auto lambda = [] { return 42; };
+  alloc_counter::guard guard;
+  function_view<int()> view = f;
+  function_view<int()> lambda_view = lambda;
+  EXPECT_EQ(84, view() + lambda_view());
+  EXPECT_EQ(0, guard.allocations());
+}
+
+TEST(allocation_test, inline_throwing_moves) {
+  using inline_func_t = function<int(), inline_throwing_moves>;
+  alloc_counter::guard guard;
+  {
+    inline_func_t f = throwing_move_target();
+    inline_func_t g = f;
+    inline_func_t h = std::move(f);
+    g.swap(h);
+    h = std::move(g);
+    escape(h);
+    EXPECT_EQ(42, h());
+    EXPECT_NE(nullptr, h.target<throwing_move_target>());
+    EXPECT_NE(std::string_view::npos,
+              h.target_name().find("throwing_move_target"));
+    EXPECT_EQ(std::string_view::npos, h.target_name().find("nothrow_move"));
+
+    inline_func_t large = large_target();
+    EXPECT_EQ(1, guard.allocations());
+  }
+  EXPECT_EQ(1, guard.deallocations());
+}
+
+TEST(allocation_test, recursive_function) {
+  alloc_counter::guard guard;
+  recursive_function<int(int)> sum = [](auto& self, int n) {
+    return n == 0 ? 0 : n + self(n - 1);
+  };
+  escape(sum);
+  EXPECT_EQ(5050, sum(100));
+  EXPECT_EQ(0, guard.allocations());
+}
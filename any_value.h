@@ -0,0 +1,144 @@
+#pragma once
+
+#include "erased_storage.h"
+
+#include <cstddef>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// Owning container for a value of any copy constructible type, like std::any
+// but with `N` bytes of inline capacity and type checks that compare
+// descriptor pointers instead of using RTTI.
+template <std::size_t N = 3 * sizeof(void*)>
+class any_value {
+  using storage_t = erased_impl::storage<N, alignof(std::max_align_t)>;
+
+  template <typename T>
+  static constexpr bool is_value = !std::is_same_v<T, any_value>;
+
+public:
+  any_value() noexcept = default;
+
+  template <typename T,
+            typename = std::enable_if_t<is_value<std::decay_t<T>>>>
+  any_value(T&& value) {
+    emplace<std::decay_t<T>>(std::forward<T>(value));
+  }
+
+  any_value(any_value const& other) {
+    storage.copy_from(other.storage);
+  }
+
+  any_value(any_value&& other) noexcept {
+    storage.move_from(other.storage);
+  }
+
+  any_value& operator=(any_value const& other) {
+    if (this != &other) {
+      any_value tmp(other);
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  // The stored value may own `other`, so it is destroyed only after `other`
+  // was moved out
+  any_value& operator=(any_value&& other) noexcept {
+    if (this != &other) {
+      storage.move_assign(other.storage);
+    }
+    return *this;
+  }
+
+  ~any_value() = default;
+
+  template <typename T, typename... Ts>
+  T& emplace(Ts&&... args) {
+    static_assert(std::is_copy_constructible_v<T>,
+                  "any_value requires copy constructible types");
+    storage.reset();
+    return storage.template emplace<T>(std::forward<Ts>(args)...);
+  }
+
+  void reset() noexcept {
+    storage.reset();
+  }
+
+  bool has_value() const noexcept {
+    return storage.desc != storage_t::get_empty_descriptor();
+  }
+
+  // True if no allocation backs the value
+  bool is_inline() const noexcept {
+    return storage.desc->small;
+  }
+
+  template <typename T>
+  T* target() noexcept {
+    return const_cast<T*>(std::as_const(*this).template target<T>());
+  }
+
+  template <typename T>
+  T const* target() const noexcept {
+    if (storage.desc == storage_t::template get_descriptor<T>()) {
+      return storage.template get<T>();
+    } else {
+      return nullptr;
+    }
+  }
+
+  // Id of the stored type, equal to target_type_id<T>() for a value of type
+  // T and null if there is none
+  void const* target_type() const noexcept {
+    return storage.desc->type;
+  }
+
+  // Name of the stored type, empty if there is none
+  std::string_view type_name() const noexcept {
+    return storage.desc->name;
+  }
+
+  void swap(any_value& other) noexcept {
+    storage.swap(other.storage);
+  }
+
+private:
+  friend class any_ref;
+
+  storage_t storage;
+};
+
+// Non-owning reference to a mutable object of any type, two pointers wide.
+// Also refers to the value held by an any_value of any capacity.
+class any_ref {
+public:
+  any_ref() noexcept = default;
+
+  template <typename T,
+            typename = std::enable_if_t<!std::is_const_v<T> &&
+                                        !std::is_same_v<T, any_ref>>>
+  any_ref(T& value) noexcept
+      : object(std::addressof(value)), type(&erased_impl::type_tag<T>) {}
+
+  template <std::size_t N>
+  any_ref(any_value<N>& value) noexcept
+      : object(value.storage.address()), type(value.storage.desc->type) {}
+
+  explicit operator bool() const noexcept {
+    return object != nullptr;
+  }
+
+  template <typename T>
+  T* target() const noexcept {
+    if (type == &erased_impl::type_tag<T>) {
+      return static_cast<T*>(object);
+    } else {
+      return nullptr;
+    }
+  }
+
+private:
+  void* object{nullptr};
+  void const* type{nullptr};
+};
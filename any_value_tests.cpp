@@ -0,0 +1,133 @@
+#include "alloc_counter.h"
+#include "any_value.h"
+#include <gtest/gtest.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace {
+struct point {
+  int x;
+  int y;
+};
+
+using payload_t = std::array<char, 64>;
+} // namespace
+
+TEST(any_value_test, empty) {
+  any_value<> a;
+  EXPECT_FALSE(a.has_value());
+  EXPECT_EQ(nullptr, a.target<int>());
+  EXPECT_TRUE(a.type_name().empty());
+  EXPECT_EQ(nullptr, a.target_type());
+  any_value<> b = a;
+  EXPECT_FALSE(b.has_value());
+}
+
+TEST(any_value_test, target) {
+  any_value<> a = 42;
+  ASSERT_NE(nullptr, a.target<int>());
+  EXPECT_EQ(42, *a.target<int>());
+  EXPECT_EQ(nullptr, a.target<long>());
+  EXPECT_EQ("int", a.type_name());
+
+  a = point{1, 2};
+  EXPECT_EQ(nullptr, a.target<int>());
+  EXPECT_EQ(2, a.target<point>()->y);
+}
+
+TEST(any_value_test, same_ids_as_function) {
+  auto f = [] {};
+  any_value<> a = f;
+  function<void()> g = f;
+  EXPECT_EQ(target_type_id<decltype(f)>(), a.target_type());
+  EXPECT_EQ(g.target_type(), a.target_type());
+  a = 1;
+  EXPECT_EQ(target_type_id<int>(), a.target_type());
+}
+
+TEST(any_value_test, capacity) {
+  alloc_counter::guard guard;
+  any_value<64> large = payload_t{};
+  any_value<> small = point{1, 2};
+  EXPECT_TRUE(large.is_inline());
+  EXPECT_TRUE(small.is_inline());
+  EXPECT_EQ(0, guard.allocations());
+
+  any_value<> heap = payload_t{};
+  EXPECT_FALSE(heap.is_inline());
+  EXPECT_EQ(1, guard.allocations());
+}
+
+TEST(any_value_test, copy_move_swap) {
+  any_value<> a = std::string(100, 'a');
+  any_value<> b = a;
+  EXPECT_EQ(std::string(100, 'a'), *b.target<std::string>());
+
+  any_value<> c = std::move(a);
+  EXPECT_FALSE(a.has_value());
+  EXPECT_EQ(100u, c.target<std::string>()->size());
+
+  any_value<> d = std::vector<int>{1, 2, 3};
+  c.swap(d);
+  EXPECT_EQ(3u, c.target<std::vector<int>>()->size());
+  EXPECT_EQ(100u, d.target<std::string>()->size());
+
+  any_value<> e = payload_t{'x'};
+  e.swap(c);
+  EXPECT_EQ('x', (*c.target<payload_t>())[0]);
+  EXPECT_EQ(3u, e.target<std::vector<int>>()->size());
+
+  c = d;
+  d = std::move(e);
+  EXPECT_EQ(100u, c.target<std::string>()->size());
+  EXPECT_EQ(3u, d.target<std::vector<int>>()->size());
+  EXPECT_FALSE(e.has_value());
+}
+
+TEST(any_value_test, move_assign_from_own_value) {
+  using values_t = std::vector<any_value<>>;
+  any_value<> a = values_t(1, std::string(100, 'a'));
+  a = std::move(a.target<values_t>()->front());
+  ASSERT_NE(nullptr, a.target<std::string>());
+  EXPECT_EQ(100u, a.target<std::string>()->size());
+
+  a = values_t(1, values_t(2));
+  a = std::move(a.target<values_t>()->front());
+  ASSERT_NE(nullptr, a.target<values_t>());
+  EXPECT_EQ(2u, a.target<values_t>()->size());
+}
+
+TEST(any_value_test, emplace) {
+  any_value<> a;
+  auto& s = a.emplace<std::string>(3, 'z');
+  EXPECT_EQ("zzz", s);
+  a.emplace<int>(7);
+  EXPECT_EQ(7, *a.target<int>());
+  a.reset();
+  EXPECT_FALSE(a.has_value());
+}
+
+TEST(any_value_test, any_ref) {
+  int x = 1;
+  any_ref r = x;
+  ASSERT_NE(nullptr, r.target<int>());
+  *r.target<int>() = 2;
+  EXPECT_EQ(2, x);
+  EXPECT_EQ(nullptr, r.target<long>());
+
+  any_value<> a = point{3, 4};
+  any_ref ra = a;
+  EXPECT_EQ(4, ra.target<point>()->y);
+  EXPECT_EQ(a.target<point>(), ra.target<point>());
+
+  any_value<> heap = payload_t{'h'};
+  any_ref rh = heap;
+  EXPECT_EQ('h', (*rh.target<payload_t>())[0]);
+
+  any_value<> empty;
+  any_ref re = empty;
+  EXPECT_FALSE(static_cast<bool>(re));
+  EXPECT_EQ(nullptr, re.target<int>());
+}
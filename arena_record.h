@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// Layout shared by the arenas of deferred_queue and cleanup_stack: every
+// callable is preceded by a record, whose type is up to the arena, and
+// follows it at the next address suitably aligned for the callable.
+namespace arena_impl {
+
+inline std::size_t padding(std::uintptr_t address,
+                           std::size_t align) noexcept {
+  return (align - address % align) % align;
+}
+
+// Offsets in a chunk of a record placed at the first suitable address from
+// `used` on, and one past the object of `size` bytes that follows it
+struct placement {
+  std::size_t record;
+  std::size_t end;
+};
+
+template <typename Record>
+placement place(std::uintptr_t base, std::size_t used, std::size_t size,
+                std::size_t align) noexcept {
+  std::size_t record = used + padding(base + used, alignof(Record));
+  std::uintptr_t after = base + record + sizeof(Record);
+  return {record, record + sizeof(Record) + padding(after, align) + size};
+}
+
+// Address of the object aligned to `align` that follows `record`
+template <typename Record>
+void* object_address(Record* record, std::size_t align) noexcept {
+  auto after = reinterpret_cast<std::uintptr_t>(record + 1);
+  return reinterpret_cast<void*>(after + padding(after, align));
+}
+
+// Stored in the records: calls the F following a record that ends at
+// `after` if `call` is set, then destroys it, even if the call throws
+template <typename F>
+void consume(void* after, bool call) {
+  auto address = reinterpret_cast<std::uintptr_t>(after);
+  F& f = *std::launder(
+      reinterpret_cast<F*>(address + padding(address, alignof(F))));
+  struct destroy {
+    ~destroy() {
+      f.~F();
+    }
+
+    F& f;
+  } guard{f};
+  if (call) {
+    f();
+  }
+}
+} // namespace arena_impl
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "perf_counters.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// Keeps the optimizer from discarding a value or assuming anything about
+// memory reachable from it
+template <typename T>
+void do_not_optimize(T& value) {
+#if defined(__GNUC__)
+  asm volatile("" : : "r"(&value) : "memory");
+#else
+  static_cast<void>(*reinterpret_cast<char volatile*>(&value));
+#endif
+}
+
+struct options {
+  std::size_t ops{1'000'000};
+  bool counters{false};
+  char const* filter{nullptr};
+
+  static options parse(int argc, char* argv[]) {
+    options result;
+    for (int i = 1; i < argc; ++i) {
+      if (std::strcmp(argv[i], "--counters") == 0) {
+        result.counters = true;
+      } else if (std::strcmp(argv[i], "--ops") == 0 && i + 1 < argc) {
+        result.ops = std::stoul(argv[++i]);
+      } else if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+        result.filter = argv[++i];
+      } else {
+        std::fprintf(stderr,
+                     "usage: %s [--ops N] [--filter SUBSTRING] [--counters]\n",
+                     argv[0]);
+        std::exit(2);
+      }
+    }
+    return result;
+  }
+};
+
+struct result {
+  std::string name;
+  std::size_t ops;
+  double ns;
+  perf_counters::values_t counts;
+};
+
+// Collects per-operation wall-clock time and, with --counters, hardware
+// counter values of benchmark bodies
+class harness {
+public:
+  explicit harness(options opts) : opts(opts) {
+    if (opts.counters && !counters.available()) {
+      std::fprintf(stderr, "perf_event_open is unavailable, reporting "
+                           "wall-clock time only\n");
+    }
+  }
+
+  bool enabled(char const* name) const {
+    return opts.filter == nullptr || std::strstr(name, opts.filter) != nullptr;
+  }
+
+  std::size_t ops() const noexcept {
+    return opts.ops;
+  }
+
+  // Measures `body`, which has to perform ops() operations. Setup and
+  // teardown belong outside of it. Bodies filtered out are still run, as
+  // later benchmarks may depend on their effects, but are not reported.
+  template <typename F>
+  void measure(char const* name, F&& body) {
+    if (!enabled(name)) {
+      body();
+      return;
+    }
+    bool with_counters = opts.counters && counters.available();
+    if (with_counters) {
+      counters.start();
+    }
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto finish = std::chrono::steady_clock::now();
+    perf_counters::values_t counts{};
+    if (with_counters) {
+      counts = counters.stop();
+    }
+    results.push_back(
+        {name, opts.ops,
+         std::chrono::duration<double, std::nano>(finish - start).count(),
+         counts});
+  }
+
+  void report(std::FILE* out) const {
+    bool with_counters = opts.counters && counters.available();
+    std::fprintf(out, "%-28s %10s", "benchmark", "ns/op");
+    if (with_counters) {
+      for (std::size_t i = 0; i < perf_counters::n_events; ++i) {
+        std::fprintf(out, " %14s", perf_counters::names[i]);
+      }
+    }
+    std::fprintf(out, "\n");
+    for (auto const& r : results) {
+      double ops = static_cast<double>(r.ops);
+      std::fprintf(out, "%-28s %10.2f", r.name.c_str(), r.ns / ops);
+      if (with_counters) {
+        for (std::size_t i = 0; i < perf_counters::n_events; ++i) {
+          if (counters.available(static_cast<perf_counters::event>(i))) {
+            std::fprintf(out, " %14.3f", r.counts[i] / ops);
+          } else {
+            std::fprintf(out, " %14s", "n/a");
+          }
+        }
+      }
+      std::fprintf(out, "\n");
+    }
+  }
+
+private:
+  options opts;
+  perf_counters counters;
+  std::vector<result> results;
+};
+} // namespace bench
@@ -0,0 +1,96 @@
+// Microbenchmarks of the basic function operations. Run with --counters to
+// also get per-operation hardware counter values.
+#include "../function.h"
+#include "bench.h"
+
+#include <memory>
+
+namespace {
+using func_t = function<int(int)>;
+
+struct small_target {
+  int operator()(int x) const {
+    return x + value;
+  }
+
+  int value;
+};
+
+struct large_target {
+  int operator()(int x) const {
+    return x + payload[0];
+  }
+
+  int payload[16];
+};
+
+// Uninitialized storage for the objects a benchmark constructs or destroys
+struct buffer {
+  explicit buffer(std::size_t n)
+      : data(std::make_unique<std::aligned_storage_t<sizeof(func_t),
+                                                     alignof(func_t)>[]>(n)),
+        size(n) {}
+
+  func_t* operator[](std::size_t i) {
+    return std::launder(reinterpret_cast<func_t*>(&data[i]));
+  }
+
+  void* raw(std::size_t i) {
+    return &data[i];
+  }
+
+  void destroy() {
+    for (std::size_t i = 0; i < size; ++i) {
+      (*this)[i]->~func_t();
+    }
+  }
+
+  std::unique_ptr<std::aligned_storage_t<sizeof(func_t), alignof(func_t)>[]>
+      data;
+  std::size_t size;
+};
+
+template <typename T>
+void run_all(bench::harness& h, std::string const& kind, T target) {
+  std::size_t n = h.ops();
+  buffer objects(n);
+
+  h.measure(("construct/" + kind).c_str(), [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      new (objects.raw(i)) func_t(target);
+    }
+    bench::do_not_optimize(objects);
+  });
+
+  func_t f = target;
+  h.measure(("invoke/" + kind).c_str(), [&] {
+    int sum = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      bench::do_not_optimize(f);
+      sum += f(static_cast<int>(i));
+    }
+    bench::do_not_optimize(sum);
+  });
+
+  buffer copies(n);
+  h.measure(("copy/" + kind).c_str(), [&] {
+    for (std::size_t i = 0; i < n; ++i) {
+      new (copies.raw(i)) func_t(*objects[i]);
+    }
+    bench::do_not_optimize(copies);
+  });
+  copies.destroy();
+
+  h.measure(("destroy/" + kind).c_str(), [&] {
+    objects.destroy();
+    bench::do_not_optimize(objects);
+  });
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+  bench::harness h(bench::options::parse(argc, argv));
+  run_all(h, "small", small_target{1});
+  run_all(h, "large", large_target{{1}});
+  h.report(stdout);
+}
@@ -0,0 +1,124 @@
+#!/bin/bash
+# Build-time benchmark of the ways to consume function: K generated
+# translation units using the common signatures are compiled
+#   - including function.h,
+#   - including function.h with FUNCTION_EXTERN_TEMPLATES, plus function.cpp,
+#   - importing the function module (GCC -fmodules-ts or Clang), plus the
+#     module interface unit.
+#
+# The extern templates only cover the class members of the common
+# signatures, every TU still instantiates the code for its own targets, so
+# expect no gain from them; the module variant saves the parsing.
+#
+#   CXX=g++ CXXFLAGS=-O2 bench/build-bench.sh [K]
+set -euo pipefail
+IFS=$' \t\n'
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+SOURCE_DIR="${SCRIPT_DIR}/.."
+K=${1:-32}
+CXX=${CXX:-c++}
+CXXFLAGS=${CXXFLAGS:--O2}
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "${WORK_DIR}"' EXIT
+
+# generate <directory> <prologue>
+generate() {
+    mkdir -p "${1}"
+    for (( i = 0; i < K; ++i )); do
+        cat > "${1}/tu${i}.cpp" <<EOT
+${2}
+
+int use${i}(int x) {
+  function<void()> a = [] {};
+  function<void(int)> b = [&x](int y) { x += y; };
+  function<bool()> c = [x] { return x > ${i}; };
+  function<bool(int const&)> d = [](int const& y) { return y % 2 == 0; };
+
+  function<void()> a2 = a;
+  a2.swap(a);
+  a = std::move(a2);
+  a();
+  b(${i});
+  function<void(int)> b2;
+  b2 = b;
+  b2(1);
+  return c() + d(x) + static_cast<bool>(b2);
+}
+EOT
+    done
+}
+
+now() {
+    date +%s%N
+}
+
+seconds() {
+    awk -v ns="${1}" 'BEGIN { printf "%.2f", ns / 1e9 }'
+}
+
+# compile_all <directory> <flags...>, prints the elapsed nanoseconds
+compile_all() {
+    local directory=${1}
+    shift
+    local start
+    start=$(now)
+    for (( i = 0; i < K; ++i )); do
+        (cd "${directory}" && ${CXX} -std=c++20 ${CXXFLAGS} "$@" \
+            -c "tu${i}.cpp" -o "tu${i}.o")
+    done
+    echo $(( $(now) - start ))
+}
+
+# text_size <directory>
+text_size() {
+    size -A "${1}"/*.o |
+        awk '$1 ~ /^\.text/ { sum += $2 } END { print sum + 0 }'
+}
+
+# report <name> <setup ns> <compile ns> <directory>
+report() {
+    printf "%-10s %10s %10s %10s %12s\n" "${1}" "$(seconds "${2}")" \
+        "$(seconds "${3}")" "$(seconds $(( ${2} + ${3} )))" "$(text_size "${4}")"
+}
+
+echo "${K} translation units, ${CXX} ${CXXFLAGS}"
+printf "%-10s %10s %10s %10s %12s\n" "variant" "setup" "TUs" "total" ".text"
+
+generate "${WORK_DIR}/header" '#include "function.h"'
+report header 0 "$(compile_all "${WORK_DIR}/header" -I"${SOURCE_DIR}")" \
+    "${WORK_DIR}/header"
+
+generate "${WORK_DIR}/extern" '#include "function.h"'
+start=$(now)
+${CXX} -std=c++20 ${CXXFLAGS} -DFUNCTION_EXTERN_TEMPLATES \
+    -c "${SOURCE_DIR}/function.cpp" -o "${WORK_DIR}/extern/function.o"
+setup=$(( $(now) - start ))
+report extern "${setup}" \
+    "$(compile_all "${WORK_DIR}/extern" -I"${SOURCE_DIR}" \
+        -DFUNCTION_EXTERN_TEMPLATES)" \
+    "${WORK_DIR}/extern"
+
+# GCC needs <new> in the importer for placement new to be visible
+generate "${WORK_DIR}/module" $'#include <new>\n#include <utility>\nimport function;'
+cd "${WORK_DIR}/module"
+start=$(now)
+if ${CXX} --version | grep -q clang; then
+    ${CXX} -std=c++20 ${CXXFLAGS} -I"${SOURCE_DIR}" --precompile -x c++-module \
+        "${SOURCE_DIR}/function.cppm" -o function.pcm 2> /dev/null &&
+        ${CXX} -std=c++20 ${CXXFLAGS} -c function.pcm -o function.o &&
+        module_flags=(-fmodule-file=function=function.pcm)
+else
+    ${CXX} -std=c++20 ${CXXFLAGS} -fmodules-ts -I"${SOURCE_DIR}" -x c++ \
+        -c "${SOURCE_DIR}/function.cppm" -o function.o 2> /dev/null &&
+        module_flags=(-fmodules-ts)
+fi
+setup=$(( $(now) - start ))
+cd - > /dev/null
+if [[ -n "${module_flags[*]:-}" ]]; then
+    report module "${setup}" \
+        "$(compile_all "${WORK_DIR}/module" "${module_flags[@]}")" \
+        "${WORK_DIR}/module"
+else
+    echo "module     not supported by ${CXX}"
+fi
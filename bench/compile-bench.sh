@@ -0,0 +1,85 @@
+#!/bin/bash
+# Compile-time and binary-size benchmark of template instantiation: generates
+# a translation unit storing N distinct callable types in M signatures and
+# compiles it once with `function` and once with `std::function`.
+#
+#   CXX=g++ CXXFLAGS=-O2 bench/compile-bench.sh [N] [M]
+set -euo pipefail
+IFS=$' \t\n'
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+N=${1:-200}
+M=${2:-4}
+CXX=${CXX:-c++}
+CXXFLAGS=${CXXFLAGS:--O2}
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "${WORK_DIR}"' EXIT
+
+SIGNATURES=(
+    "int(int)"
+    "void()"
+    "double(double, int)"
+    "bool(int const&)"
+    "long(long, long)"
+    "void(int*)"
+    "char(char)"
+    "unsigned(unsigned, unsigned, unsigned)"
+)
+if (( M < 1 || M > ${#SIGNATURES[@]} )); then
+    echo "M must be between 1 and ${#SIGNATURES[@]}" >&2
+    exit 2
+fi
+
+# generate <file> <header> <template>
+generate() {
+    {
+        echo "#include ${2}"
+        echo
+        echo "template <int I>"
+        echo "struct callable {"
+        echo "  template <typename... Ts>"
+        echo "  int operator()(Ts&&...) const {"
+        echo "    return I;"
+        echo "  }"
+        echo "};"
+        echo
+        for (( j = 0; j < M; ++j )); do
+            echo "void sink(${3}<${SIGNATURES[j]}>);"
+        done
+        echo
+        echo "void instantiate() {"
+        for (( i = 0; i < N; ++i )); do
+            for (( j = 0; j < M; ++j )); do
+                echo "  sink(${3}<${SIGNATURES[j]}>(callable<${i}>()));"
+            done
+        done
+        echo "}"
+    } > "${1}"
+}
+
+# measure <name> <source>
+measure() {
+    local object="${WORK_DIR}/${1}.o"
+    local start finish
+    start=$(date +%s%N)
+    ${CXX} -std=c++20 ${CXXFLAGS} -I"${SCRIPT_DIR}/.." -c "${2}" -o "${object}"
+    finish=$(date +%s%N)
+
+    local object_size text_size symbols
+    object_size=$(stat -c %s "${object}")
+    text_size=$(size -A "${object}" |
+        awk '$1 ~ /^\.text/ { sum += $2 } END { print sum + 0 }')
+    symbols=$(nm --defined-only "${object}" | wc -l)
+    printf "%-16s %10.2f %12d %12d %10d\n" "${1}" \
+        "$(awk -v ns="$(( finish - start ))" 'BEGIN { print ns / 1e9 }')" \
+        "${object_size}" "${text_size}" "${symbols}"
+}
+
+generate "${WORK_DIR}/function.cpp" '"function.h"' "function"
+generate "${WORK_DIR}/std_function.cpp" '<functional>' "std::function"
+
+echo "${N} callables x ${M} signatures, ${CXX} ${CXXFLAGS}"
+printf "%-16s %10s %12s %12s %10s\n" \
+    "implementation" "seconds" "object" ".text" "symbols"
+measure "function" "${WORK_DIR}/function.cpp"
+measure "std::function" "${WORK_DIR}/std_function.cpp"
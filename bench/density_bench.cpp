@@ -0,0 +1,172 @@
+// Memory-density benchmark: builds a large collection of callbacks with
+// captures drawn from a size distribution, reports how many bytes each of
+// them costs (the object itself, the requested heap bytes and what the
+// allocator and the kernel actually account for) and times a full
+// scan-and-invoke pass over the collection.
+#include "../alloc_counter.h"
+#include "../function.h"
+#include "bench.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+#include <unistd.h>
+
+namespace {
+using callback_t = function<std::uint64_t(std::uint64_t)>;
+
+template <std::size_t N>
+struct capture {
+  std::uint64_t operator()(std::uint64_t x) const {
+    return x + data[x % N];
+  }
+
+  std::array<unsigned char, N> data{};
+};
+
+constexpr std::array<std::size_t, 6> capture_sizes = {8, 16, 24, 32, 64, 256};
+
+template <std::size_t... I>
+callback_t make_capture(std::size_t size_class, std::index_sequence<I...>) {
+  callback_t result;
+  ((size_class == I ? (result = capture<capture_sizes[I]>{}, true) : false) ||
+   ...);
+  return result;
+}
+
+struct config {
+  std::size_t count{1'000'000};
+  std::uint64_t seed{42};
+  std::size_t passes{3};
+  // Relative frequencies of capture_sizes
+  std::array<unsigned, capture_sizes.size()> sizes{40, 25, 15, 10, 7, 3};
+};
+
+config parse(int argc, char* argv[]) {
+  config result;
+  for (int i = 1; i < argc; ++i) {
+    auto is = [&](char const* name) {
+      return std::strcmp(argv[i], name) == 0 && i + 1 < argc;
+    };
+    if (is("--count")) {
+      result.count = std::stoull(argv[++i]);
+    } else if (is("--seed")) {
+      result.seed = std::stoull(argv[++i]);
+    } else if (is("--passes")) {
+      result.passes = std::stoull(argv[++i]);
+    } else if (is("--sizes")) {
+      char const* text = argv[++i];
+      for (std::size_t j = 0; j < result.sizes.size(); ++j) {
+        char* end;
+        result.sizes[j] = static_cast<unsigned>(std::strtoul(text, &end, 10));
+        text = end + (*end == ',' ? 1 : 0);
+      }
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--count N] [--seed N] [--passes N]\n"
+                   "          [--sizes w8,w16,w24,w32,w64,w256]\n",
+                   argv[0]);
+      std::exit(2);
+    }
+  }
+  return result;
+}
+
+struct memory {
+  long rss;
+  std::size_t heap_in_use;
+
+  static memory now() {
+    memory result{};
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0;
+    long resident = 0;
+    if (statm >> pages >> resident) {
+      result.rss = resident * sysconf(_SC_PAGESIZE);
+    }
+#if defined(__GLIBC__) &&                                                      \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    result.heap_in_use = info.uordblks + info.hblkhd;
+#elif defined(__GLIBC__)
+    struct mallinfo info = mallinfo();
+    result.heap_in_use = static_cast<unsigned>(info.uordblks) +
+                         static_cast<unsigned>(info.hblkhd);
+#endif
+    return result;
+  }
+};
+} // namespace
+
+int main(int argc, char* argv[]) {
+  config cfg = parse(argc, argv);
+
+  std::mt19937_64 rng(cfg.seed);
+  std::discrete_distribution<int> sizes(cfg.sizes.begin(), cfg.sizes.end());
+  std::vector<std::uint8_t> classes(cfg.count);
+  for (auto& c : classes) {
+    c = static_cast<std::uint8_t>(sizes(rng));
+  }
+
+  memory before = memory::now();
+  std::vector<callback_t> callbacks;
+  alloc_counter::guard heap;
+  auto build_start = std::chrono::steady_clock::now();
+  callbacks.reserve(cfg.count);
+  // Whatever reserve allocated, none of it if the count is 0
+  std::size_t array_allocations = heap.allocations();
+  std::size_t array_bytes = heap.bytes();
+  for (auto c : classes) {
+    callbacks.push_back(make_capture(
+        c, std::make_index_sequence<capture_sizes.size()>()));
+  }
+  auto build_finish = std::chrono::steady_clock::now();
+  std::size_t requested = heap.bytes() - array_bytes;
+  std::size_t targets_on_heap = heap.allocations() - array_allocations;
+  memory after = memory::now();
+
+  double best_pass = 0;
+  for (std::size_t pass = 0; pass < cfg.passes; ++pass) {
+    std::uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (auto& callback : callbacks) {
+      sum = callback(sum);
+    }
+    auto finish = std::chrono::steady_clock::now();
+    bench::do_not_optimize(sum);
+    double ns =
+        std::chrono::duration<double, std::nano>(finish - start).count();
+    if (pass == 0 || ns < best_pass) {
+      best_pass = ns;
+    }
+  }
+
+  // Averages over no callbacks are reported as 0
+  double n = static_cast<double>(std::max<std::size_t>(cfg.count, 1));
+  std::printf("callbacks           %zu (%zu with heap targets)\n", cfg.count,
+              targets_on_heap);
+  std::printf("object              %zu bytes/callback\n", sizeof(callback_t));
+  std::printf("heap requested      %.2f bytes/callback\n", requested / n);
+  std::printf("heap in use         %.2f bytes/callback (mallinfo, includes "
+              "the object array)\n",
+              static_cast<double>(after.heap_in_use - before.heap_in_use) / n);
+  std::printf("rss                 %.2f bytes/callback\n",
+              static_cast<double>(after.rss - before.rss) / n);
+  std::printf("build               %.2f ns/callback\n",
+              std::chrono::duration<double, std::nano>(build_finish -
+                                                       build_start)
+                      .count() /
+                  n);
+  std::printf("scan and invoke     %.2f ns/callback (best of %zu passes)\n",
+              best_pass / n, cfg.passes);
+}
@@ -0,0 +1,336 @@
+// Event-driven macro benchmark: replays a synthetic workload of subscription
+// churn, fan-out emits and one-shot timers through `function`, with captures
+// drawn from a configurable size distribution. The workload is generated
+// from a seed up front (or loaded with --trace), so runs are repeatable and
+// generation is not measured.
+#include "../alloc_counter.h"
+#include "../function.h"
+#include "bench.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+struct event {
+  std::uint32_t topic;
+  std::uint64_t value;
+};
+
+using callback_t = function<void(event const&)>;
+using timer_callback_t = function<void()>;
+
+std::uint64_t sink = 0;
+
+template <std::size_t N>
+struct capture {
+  void operator()(event const& e) const {
+    sink += data[e.value % N] + e.value;
+  }
+
+  void operator()() const {
+    sink += data[0];
+  }
+
+  std::array<unsigned char, N> data{};
+};
+
+constexpr std::array<std::size_t, 6> capture_sizes = {8, 16, 32, 64, 128, 512};
+
+template <typename F, std::size_t... I>
+F make_capture(std::size_t size_class, std::index_sequence<I...>) {
+  F result;
+  ((size_class == I ? (result = capture<capture_sizes[I]>{}, true) : false) ||
+   ...);
+  return result;
+}
+
+template <typename F>
+F make_capture(std::size_t size_class) {
+  return make_capture<F>(size_class,
+                         std::make_index_sequence<capture_sizes.size()>());
+}
+
+enum class op_kind : std::uint8_t {
+  subscribe,
+  unsubscribe,
+  emit,
+  schedule,
+  tick,
+  n_kinds
+};
+
+constexpr std::array<char const*, 5> op_names = {"subscribe", "unsubscribe",
+                                                 "emit", "schedule", "tick"};
+
+struct op {
+  op_kind kind;
+  std::uint8_t size_class;
+  std::uint32_t arg;
+};
+
+struct config {
+  std::uint64_t seed{42};
+  std::size_t ops{1'000'000};
+  std::uint32_t topics{64};
+  // Relative frequencies of op_kind values
+  std::array<unsigned, 5> mix{20, 18, 40, 15, 7};
+  // Relative frequencies of capture_sizes
+  std::array<unsigned, capture_sizes.size()> sizes{50, 20, 15, 8, 5, 2};
+  char const* trace{nullptr};
+  char const* record{nullptr};
+};
+
+template <std::size_t N>
+void parse_list(char const* text, std::array<unsigned, N>& out) {
+  for (std::size_t i = 0; i < N; ++i) {
+    char* end;
+    out[i] = static_cast<unsigned>(std::strtoul(text, &end, 10));
+    if (*end != (i + 1 == N ? '\0' : ',')) {
+      std::fprintf(stderr, "expected %zu comma-separated weights\n", N);
+      std::exit(2);
+    }
+    text = end + 1;
+  }
+}
+
+config parse(int argc, char* argv[]) {
+  config result;
+  for (int i = 1; i < argc; ++i) {
+    auto is = [&](char const* name) {
+      return std::strcmp(argv[i], name) == 0 && i + 1 < argc;
+    };
+    if (is("--seed")) {
+      result.seed = std::stoull(argv[++i]);
+    } else if (is("--ops")) {
+      result.ops = std::stoull(argv[++i]);
+    } else if (is("--topics")) {
+      result.topics = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+    } else if (is("--mix")) {
+      parse_list(argv[++i], result.mix);
+    } else if (is("--sizes")) {
+      parse_list(argv[++i], result.sizes);
+    } else if (is("--trace")) {
+      result.trace = argv[++i];
+    } else if (is("--record")) {
+      result.record = argv[++i];
+    } else {
+      std::fprintf(
+          stderr,
+          "usage: %s [--seed N] [--ops N] [--topics N]\n"
+          "          [--mix subscribe,unsubscribe,emit,schedule,tick]\n"
+          "          [--sizes w8,w16,w32,w64,w128,w512]\n"
+          "          [--trace FILE | --record FILE]\n",
+          argv[0]);
+      std::exit(2);
+    }
+  }
+  return result;
+}
+
+std::vector<op> generate(config const& cfg) {
+  std::mt19937_64 rng(cfg.seed);
+  std::discrete_distribution<int> kinds(cfg.mix.begin(), cfg.mix.end());
+  std::discrete_distribution<int> sizes(cfg.sizes.begin(), cfg.sizes.end());
+  std::uniform_int_distribution<std::uint32_t> topics(0, cfg.topics - 1);
+  std::uniform_int_distribution<std::uint32_t> delays(1, 64);
+  std::uniform_int_distribution<std::uint32_t> any;
+
+  std::vector<op> result(cfg.ops);
+  for (auto& o : result) {
+    o.kind = static_cast<op_kind>(kinds(rng));
+    o.size_class = static_cast<std::uint8_t>(sizes(rng));
+    switch (o.kind) {
+    case op_kind::subscribe:
+    case op_kind::emit:
+      o.arg = topics(rng);
+      break;
+    case op_kind::schedule:
+      o.arg = delays(rng);
+      break;
+    default:
+      o.arg = any(rng);
+      break;
+    }
+  }
+  return result;
+}
+
+// Subscribers of one topic with unordered removal, as signal implementations
+// that do not guarantee ordering do
+struct topic {
+  std::vector<callback_t> subscribers;
+};
+
+struct timer_entry {
+  std::uint64_t deadline;
+  std::uint64_t sequence;
+  timer_callback_t callback;
+
+  bool operator>(timer_entry const& other) const {
+    return deadline != other.deadline ? deadline > other.deadline
+                                      : sequence > other.sequence;
+  }
+};
+
+class system_under_test {
+public:
+  explicit system_under_test(std::uint32_t n_topics) : topics(n_topics) {}
+
+  void apply(op const& o) {
+    switch (o.kind) {
+    case op_kind::subscribe:
+      topics[o.arg].subscribers.push_back(
+          make_capture<callback_t>(o.size_class));
+      ++n_subscribers;
+      break;
+    case op_kind::unsubscribe: {
+      if (n_subscribers == 0) {
+        break;
+      }
+      auto& list = topics[o.arg % topics.size()].subscribers;
+      if (list.empty()) {
+        break;
+      }
+      std::size_t victim = (o.arg / topics.size()) % list.size();
+      list[victim] = std::move(list.back());
+      list.pop_back();
+      --n_subscribers;
+      break;
+    }
+    case op_kind::emit: {
+      event e{o.arg, now};
+      for (auto& subscriber : topics[o.arg].subscribers) {
+        subscriber(e);
+      }
+      break;
+    }
+    case op_kind::schedule:
+      timers.push_back({now + o.arg, sequence++,
+                        make_capture<timer_callback_t>(o.size_class)});
+      std::push_heap(timers.begin(), timers.end(), std::greater<>());
+      break;
+    case op_kind::tick:
+      ++now;
+      while (!timers.empty() && timers.front().deadline <= now) {
+        std::pop_heap(timers.begin(), timers.end(), std::greater<>());
+        timer_callback_t callback = std::move(timers.back().callback);
+        timers.pop_back();
+        callback();
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+private:
+  std::vector<topic> topics;
+  std::size_t n_subscribers{0};
+  // Min-heap on deadline
+  std::vector<timer_entry> timers;
+  std::uint64_t now{0};
+  std::uint64_t sequence{0};
+};
+
+long current_rss_kb() {
+  std::ifstream statm("/proc/self/statm");
+  long pages = 0;
+  long resident = 0;
+  if (!(statm >> pages >> resident)) {
+    return -1;
+  }
+  return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+double percentile(std::vector<std::uint32_t>& samples, double p) {
+  if (samples.empty()) {
+    return 0;
+  }
+  std::size_t index = static_cast<std::size_t>(p * (samples.size() - 1));
+  std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+  return samples[index];
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+  config cfg = parse(argc, argv);
+
+  std::vector<op> trace;
+  if (cfg.trace != nullptr) {
+    std::ifstream in(cfg.trace, std::ios::binary);
+    op o;
+    while (in.read(reinterpret_cast<char*>(&o), sizeof(o))) {
+      trace.push_back(o);
+    }
+    for (auto const& t : trace) {
+      if (t.kind >= op_kind::n_kinds || t.size_class >= capture_sizes.size()) {
+        std::fprintf(stderr, "malformed trace %s\n", cfg.trace);
+        return 1;
+      }
+      if (t.kind == op_kind::subscribe || t.kind == op_kind::emit) {
+        cfg.topics = std::max(cfg.topics, t.arg + 1);
+      }
+    }
+  } else {
+    trace = generate(cfg);
+  }
+  if (cfg.record != nullptr) {
+    std::ofstream out(cfg.record, std::ios::binary);
+    out.write(reinterpret_cast<char const*>(trace.data()),
+              static_cast<std::streamsize>(trace.size() * sizeof(op)));
+  }
+
+  system_under_test system(cfg.topics);
+  std::array<std::vector<std::uint32_t>, op_names.size()> latencies;
+  for (auto& l : latencies) {
+    l.reserve(trace.size());
+  }
+
+  long rss_before = current_rss_kb();
+  alloc_counter::guard allocations;
+  auto start = std::chrono::steady_clock::now();
+  for (auto const& o : trace) {
+    auto op_start = std::chrono::steady_clock::now();
+    system.apply(o);
+    auto op_finish = std::chrono::steady_clock::now();
+    latencies[static_cast<std::size_t>(o.kind)].push_back(
+        static_cast<std::uint32_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(op_finish -
+                                                                 op_start)
+                .count()));
+  }
+  auto finish = std::chrono::steady_clock::now();
+  std::size_t n_allocations = allocations.allocations();
+  long rss_after = current_rss_kb();
+  bench::do_not_optimize(sink);
+
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  double seconds = std::chrono::duration<double>(finish - start).count();
+  double ops = static_cast<double>(trace.size());
+
+  std::printf("ops                 %zu\n", trace.size());
+  std::printf("throughput          %.0f ops/s\n", ops / seconds);
+  std::printf("allocations/op      %.3f\n", n_allocations / ops);
+  std::printf("rss                 %ld kB (+%ld kB, peak %ld kB)\n", rss_after,
+              rss_after - rss_before, usage.ru_maxrss);
+  std::printf("%-12s %10s %10s %10s\n", "operation", "count", "p50 ns",
+              "p99 ns");
+  for (std::size_t i = 0; i < op_names.size(); ++i) {
+    std::printf("%-12s %10zu %10.0f %10.0f\n", op_names[i],
+                latencies[i].size(), percentile(latencies[i], 0.5),
+                percentile(latencies[i], 0.99));
+  }
+}
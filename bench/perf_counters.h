@@ -0,0 +1,133 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+// Hardware counters read around a benchmark through perf_event_open. Each
+// event is opened on its own, so an event the CPU or the hypervisor does not
+// expose only loses its own column. Inside containers perf_event_open is
+// usually forbidden altogether, in which case available() is false and the
+// harness reports wall-clock time only.
+class perf_counters {
+public:
+  enum event : std::size_t {
+    instructions,
+    cycles,
+    branch_misses,
+    l1d_misses,
+    itlb_misses,
+    n_events
+  };
+
+  using values_t = std::array<double, n_events>;
+
+  static constexpr std::array<char const*, n_events> names = {
+      "instructions", "cycles", "branch-misses", "L1d-misses", "iTLB-misses"};
+
+  perf_counters() {
+    fds.fill(-1);
+#if defined(__linux__)
+    constexpr std::uint64_t read_miss =
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    open(instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    open(cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    open(branch_misses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    open(l1d_misses, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | read_miss);
+    open(itlb_misses, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_ITLB | read_miss);
+#endif
+  }
+
+  perf_counters(perf_counters const&) = delete;
+  perf_counters& operator=(perf_counters const&) = delete;
+
+  ~perf_counters() {
+#if defined(__linux__)
+    for (int fd : fds) {
+      if (fd != -1) {
+        close(fd);
+      }
+    }
+#endif
+  }
+
+  bool available() const noexcept {
+    for (int fd : fds) {
+      if (fd != -1) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool available(event e) const noexcept {
+    return fds[e] != -1;
+  }
+
+  void start() noexcept {
+#if defined(__linux__)
+    for (int fd : fds) {
+      if (fd != -1) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+#endif
+  }
+
+  // Returns the counts since start(), scaled up if the kernel had to
+  // multiplex the counters. Unavailable events read as zero.
+  values_t stop() noexcept {
+    values_t result{};
+#if defined(__linux__)
+    for (int fd : fds) {
+      if (fd != -1) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      }
+    }
+    for (std::size_t i = 0; i < n_events; ++i) {
+      std::uint64_t data[3];
+      if (fds[i] == -1 || ::read(fds[i], data, sizeof(data)) != sizeof(data)) {
+        continue;
+      }
+      // data = {value, time enabled, time running}
+      result[i] = data[2] == 0 ? 0.0
+                               : static_cast<double>(data[0]) *
+                                     static_cast<double>(data[1]) /
+                                     static_cast<double>(data[2]);
+    }
+#endif
+    return result;
+  }
+
+private:
+#if defined(__linux__)
+  void open(event e, std::uint32_t type, std::uint64_t config) noexcept {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    fds[e] =
+        static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+#endif
+
+  std::array<int, n_events> fds;
+};
+} // namespace bench
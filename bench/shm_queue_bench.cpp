@@ -0,0 +1,185 @@
+// Cross-process task queue benchmark: a parent process hands small tasks to
+// pre-forked workers, once through shm_task_queue and once as fixed-size
+// messages written to a pipe. Both carry the same registry index and
+// payload and run the task through the same thunk, so the difference is the
+// transport. Reports wall-clock time per task until all workers are done.
+#include "../shm_task_queue.h"
+#include "bench.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+constexpr std::size_t payload_size = 48;
+
+struct config {
+  std::uint64_t tasks{1'000'000};
+  int workers{4};
+  std::size_t capacity{1024};
+};
+
+config parse(int argc, char* argv[]) {
+  config result;
+  for (int i = 1; i < argc; ++i) {
+    auto is = [&](char const* name) {
+      return std::strcmp(argv[i], name) == 0 && i + 1 < argc;
+    };
+    if (is("--tasks")) {
+      result.tasks = std::stoull(argv[++i]);
+    } else if (is("--workers")) {
+      result.workers = std::stoi(argv[++i]);
+    } else if (is("--capacity")) {
+      result.capacity = std::stoull(argv[++i]);
+    } else {
+      std::fprintf(stderr,
+                   "usage: %s [--tasks N] [--workers N] [--capacity N]\n",
+                   argv[0]);
+      std::exit(2);
+    }
+  }
+  return result;
+}
+
+struct shared_state {
+  std::atomic<std::uint64_t> sum;
+  std::atomic<bool> done;
+};
+
+struct add {
+  void operator()() const {
+    state->sum.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  shared_state* state;
+  std::uint64_t n;
+};
+
+struct message {
+  std::uint32_t task;
+  alignas(std::max_align_t) unsigned char payload[payload_size];
+};
+
+static_assert(sizeof(message) <= PIPE_BUF, "pipe writes have to be atomic");
+
+template <typename Worker>
+std::vector<pid_t> fork_workers(int n, Worker worker) {
+  std::vector<pid_t> result;
+  for (int i = 0; i < n; ++i) {
+    pid_t pid = fork();
+    if (pid == -1) {
+      std::perror("fork");
+      std::exit(1);
+    }
+    if (pid == 0) {
+      worker();
+      _exit(0);
+    }
+    result.push_back(pid);
+  }
+  return result;
+}
+
+void wait_all(std::vector<pid_t> const& pids) {
+  for (pid_t pid : pids) {
+    int status;
+    waitpid(pid, &status, 0);
+  }
+}
+
+double run_queue(config const& cfg, shared_state* state) {
+  shm_task_queue<payload_size> queue(cfg.capacity);
+  auto start = std::chrono::steady_clock::now();
+  auto pids = fork_workers(cfg.workers, [&] {
+    for (;;) {
+      bool finished = state->done.load(std::memory_order_acquire);
+      if (!queue.try_run_one()) {
+        if (finished) {
+          return;
+        }
+        sched_yield();
+      }
+    }
+  });
+  for (std::uint64_t n = 1; n <= cfg.tasks; ++n) {
+    while (!queue.try_push(add{state, n})) {
+      sched_yield();
+    }
+  }
+  state->done.store(true, std::memory_order_release);
+  wait_all(pids);
+  auto finish = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(finish - start).count();
+}
+
+double run_pipe(config const& cfg, shared_state* state) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    std::perror("pipe");
+    std::exit(1);
+  }
+  auto start = std::chrono::steady_clock::now();
+  auto pids = fork_workers(cfg.workers, [&] {
+    close(fds[1]);
+    message m;
+    while (read(fds[0], &m, sizeof(m)) == sizeof(m)) {
+      shm_task_impl::registry::instance().get(m.task)(m.payload);
+    }
+  });
+  close(fds[0]);
+  message m{};
+  m.task = shm_task_impl::task_index<add>;
+  for (std::uint64_t n = 1; n <= cfg.tasks; ++n) {
+    add task{state, n};
+    std::memcpy(m.payload, &task, sizeof(task));
+    if (write(fds[1], &m, sizeof(m)) != sizeof(m)) {
+      std::perror("write");
+      std::exit(1);
+    }
+  }
+  close(fds[1]);
+  wait_all(pids);
+  auto finish = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(finish - start).count();
+}
+} // namespace
+
+int main(int argc, char* argv[]) {
+  config cfg = parse(argc, argv);
+  void* memory = mmap(nullptr, sizeof(shared_state), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    std::perror("mmap");
+    return 1;
+  }
+  auto* state = new (memory) shared_state{};
+  std::uint64_t expected = cfg.tasks * (cfg.tasks + 1) / 2;
+
+  struct transport {
+    char const* name;
+    double (*run)(config const&, shared_state*);
+  };
+  for (transport t : {transport{"shm_task_queue", &run_queue},
+                      transport{"pipe", &run_pipe}}) {
+    state->sum.store(0);
+    state->done.store(false);
+    double ns = t.run(cfg, state);
+    std::uint64_t sum = state->sum.load();
+    bench::do_not_optimize(sum);
+    std::printf("%-16s %8.2f ns/task %10.0f tasks/s%s\n", t.name,
+                ns / static_cast<double>(cfg.tasks),
+                static_cast<double>(cfg.tasks) * 1e9 / ns,
+                sum == expected ? "" : "  (tasks lost)");
+  }
+  munmap(memory, sizeof(shared_state));
+}
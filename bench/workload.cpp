@@ -0,0 +1,150 @@
+// Fixed workload for instruction-count benchmarks under callgrind, see
+// ci-extra/bench-callgrind.sh. Every operation lives in its own workload_<op>
+// function, so that --toggle-collect can restrict the measurement to it.
+#include "../function.h"
+#include "bench.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define WORKLOAD extern "C" __attribute__((noinline))
+
+namespace {
+using func_t = function<int(int)>;
+
+struct small_target {
+  int operator()(int x) const {
+    return x + value;
+  }
+
+  int value;
+};
+
+struct large_target {
+  int operator()(int x) const {
+    return x + payload[0];
+  }
+
+  int payload[16];
+};
+
+template <typename T>
+std::vector<func_t> make(std::size_t n, T target) {
+  std::vector<func_t> result(n);
+  for (auto& f : result) {
+    f = target;
+  }
+  return result;
+}
+} // namespace
+
+#define DEFINE_WORKLOADS(kind, target)                                         \
+  WORKLOAD void workload_construct_##kind(std::vector<func_t>& out,            \
+                                          std::size_t n) {                     \
+    for (std::size_t i = 0; i < n; ++i) {                                      \
+      out.emplace_back(target);                                                \
+    }                                                                          \
+  }                                                                            \
+  WORKLOAD void workload_copy_##kind(std::vector<func_t>& out,                 \
+                                     std::vector<func_t> const& in) {          \
+    for (auto const& f : in) {                                                 \
+      out.push_back(f);                                                        \
+    }                                                                          \
+  }                                                                            \
+  WORKLOAD void workload_move_##kind(std::vector<func_t>& out,                 \
+                                     std::vector<func_t>& in) {                \
+    for (auto& f : in) {                                                       \
+      out.push_back(std::move(f));                                             \
+    }                                                                          \
+  }                                                                            \
+  WORKLOAD void workload_swap_##kind(std::vector<func_t>& lhs,                 \
+                                     std::vector<func_t>& rhs) {               \
+    for (std::size_t i = 0; i < lhs.size(); ++i) {                             \
+      lhs[i].swap(rhs[i]);                                                     \
+    }                                                                          \
+  }                                                                            \
+  WORKLOAD int workload_invoke_##kind(std::vector<func_t>& in) {               \
+    int sum = 0;                                                               \
+    for (auto& f : in) {                                                       \
+      sum += f(sum);                                                           \
+    }                                                                          \
+    return sum;                                                                \
+  }                                                                            \
+  WORKLOAD void workload_destroy_##kind(std::vector<func_t>& in) {             \
+    in.clear();                                                                \
+  }                                                                            \
+                                                                               \
+  static void run_##kind(char const* op, std::size_t n) {                      \
+    std::vector<func_t> out;                                                   \
+    out.reserve(n);                                                            \
+    std::vector<func_t> in = make(n, target);                                  \
+    if (std::strcmp(op, "construct") == 0) {                                   \
+      workload_construct_##kind(out, n);                                       \
+    } else if (std::strcmp(op, "copy") == 0) {                                 \
+      workload_copy_##kind(out, in);                                           \
+    } else if (std::strcmp(op, "move") == 0) {                                 \
+      workload_move_##kind(out, in);                                           \
+    } else if (std::strcmp(op, "swap") == 0) {                                 \
+      std::vector<func_t> other = make(n, small_target{2});                    \
+      workload_swap_##kind(in, other);                                         \
+    } else if (std::strcmp(op, "invoke") == 0) {                               \
+      int sum = workload_invoke_##kind(in);                                    \
+      bench::do_not_optimize(sum);                                             \
+    } else if (std::strcmp(op, "destroy") == 0) {                              \
+      workload_destroy_##kind(in);                                             \
+    } else {                                                                   \
+      std::fprintf(stderr, "unknown operation %s\n", op);                      \
+      std::exit(2);                                                            \
+    }                                                                          \
+    bench::do_not_optimize(out);                                               \
+  }
+
+DEFINE_WORKLOADS(small, small_target{1})
+DEFINE_WORKLOADS(large, large_target{{1}})
+
+namespace {
+constexpr char const* operations[] = {"construct", "copy",   "move",
+                                      "swap",      "invoke", "destroy"};
+} // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc == 2 && std::strcmp(argv[1], "--list") == 0) {
+    for (char const* kind : {"small", "large"}) {
+      for (char const* op : operations) {
+        std::printf("%s_%s\n", op, kind);
+      }
+    }
+    return 0;
+  }
+  if (argc == 2 && std::strcmp(argv[1], "--compiler") == 0) {
+#if defined(__clang__)
+    std::printf("clang-%d.%d\n", __clang_major__, __clang_minor__);
+#elif defined(__GNUC__)
+    std::printf("gcc-%d.%d\n", __GNUC__, __GNUC_MINOR__);
+#else
+    std::printf("unknown\n");
+#endif
+    return 0;
+  }
+  if (argc != 3) {
+    std::fprintf(stderr, "usage: %s --list | --compiler | <op>_<kind> <n>\n",
+                 argv[0]);
+    return 2;
+  }
+
+  std::string op = argv[1];
+  std::size_t n = std::strtoul(argv[2], nullptr, 10);
+  std::size_t split = op.rfind('_');
+  std::string kind = split == std::string::npos ? "" : op.substr(split + 1);
+  op.resize(split == std::string::npos ? 0 : split);
+  if (kind == "small") {
+    run_small(op.c_str(), n);
+  } else if (kind == "large") {
+    run_large(op.c_str(), n);
+  } else {
+    std::fprintf(stderr, "unknown operation %s\n", argv[1]);
+    return 2;
+  }
+}
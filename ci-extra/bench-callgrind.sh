@@ -0,0 +1,79 @@
+#!/bin/bash
+# Deterministic benchmark of function operations: runs bench/workload under
+# callgrind, collecting events only inside the workload_<op> function, and
+# compares per-operation instruction and cache-miss counts with the baseline
+# checked in for the compiler the workload was built with.
+#
+#   ci-extra/bench-callgrind.sh <build-dir> [--update]
+#
+# --update rewrites the baseline instead of comparing against it. Without a
+# baseline for the compiler the script fails.
+# IR_TOLERANCE and MISS_TOLERANCE are the allowed relative increases in
+# percent, misses additionally get an absolute slack of 0.05 per operation.
+set -euo pipefail
+IFS=$' \t\n'
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+BUILD_DIR=$1
+UPDATE=${2:-}
+OPS=${OPS:-10000}
+IR_TOLERANCE=${IR_TOLERANCE:-2}
+MISS_TOLERANCE=${MISS_TOLERANCE:-10}
+
+WORKLOAD="${BUILD_DIR}/workload"
+BASELINE="${SCRIPT_DIR}/../bench/callgrind-baseline/$("${WORKLOAD}" --compiler).txt"
+OUT_DIR=$(mktemp -d)
+trap 'rm -rf "${OUT_DIR}"' EXIT
+
+# Fixed cache geometry, so that miss counts do not depend on the host CPU
+CACHES=(--I1=32768,8,64 --D1=32768,8,64 --LL=8388608,16,64)
+
+RESULTS="${OUT_DIR}/results.txt"
+echo "# operation Ir I1mr D1mr D1mw (per operation, ${OPS} operations)" > "${RESULTS}"
+for op in $("${WORKLOAD}" --list); do
+    out="${OUT_DIR}/${op}.out"
+    valgrind --tool=callgrind --cache-sim=yes "${CACHES[@]}" \
+        --toggle-collect="workload_${op}" --callgrind-out-file="${out}" \
+        "${WORKLOAD}" "${op}" "${OPS}" > /dev/null 2>&1
+    awk -v op="${op}" -v ops="${OPS}" '
+        /^events:/ { for (i = 2; i <= NF; ++i) column[$i] = i }
+        /^summary:/ {
+            printf "%s %.3f %.3f %.3f %.3f\n", op,
+                $column["Ir"] / ops, $column["I1mr"] / ops,
+                $column["D1mr"] / ops, $column["D1mw"] / ops
+        }' "${out}" >> "${RESULTS}"
+done
+
+cat "${RESULTS}"
+
+if [[ "${UPDATE}" == "--update" ]]; then
+    mkdir -p "$(dirname "${BASELINE}")"
+    cp "${RESULTS}" "${BASELINE}"
+    echo "Baseline written to ${BASELINE}"
+    exit 0
+fi
+
+# A missing baseline fails, otherwise a new compiler in CI is never checked
+if [[ ! -f "${BASELINE}" ]]; then
+    echo "No baseline for this compiler at ${BASELINE}, run with --update to record one"
+    exit 1
+fi
+
+awk -v ir_tolerance="${IR_TOLERANCE}" -v miss_tolerance="${MISS_TOLERANCE}" '
+    BEGIN { split("- Ir I1mr D1mr D1mw", name, " ") }
+    /^#/ { next }
+    FNR == NR { for (i = 2; i <= 5; ++i) baseline[$1, i] = $i; known[$1] = 1; next }
+    !($1 in known) { printf "%s: not in the baseline\n", $1; next }
+    {
+        for (i = 2; i <= 5; ++i) {
+            tolerance = i == 2 ? ir_tolerance : miss_tolerance
+            limit = baseline[$1, i] * (1 + tolerance / 100) + (i == 2 ? 0 : 0.05)
+            if ($i > limit) {
+                printf "%s: %s regressed from %s to %s per operation\n",
+                    $1, name[i], baseline[$1, i], $i
+                failed = 1
+            }
+        }
+    }
+    END { exit failed }
+' "${BASELINE}" "${RESULTS}" || { echo "Performance regression against ${BASELINE}"; exit 1; }
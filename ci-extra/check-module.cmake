@@ -0,0 +1,51 @@
+# Compiles the module interface function.cppm and MAIN, which imports it,
+# links and runs the result. Usage:
+#
+#   cmake -DCOMPILER=<c++> -DCOMPILER_ID=<GNU|Clang> -DFLAGS=<flags>
+#         -DSOURCE_DIR=<repository> -DMAIN=<module_tests.cpp>
+#         -DWORK_DIR=<directory> -P check-module.cmake
+#
+# GCC needs -fmodules-ts and keeps the compiled interface in
+# WORK_DIR/gcm.cache, Clang precompiles it into WORK_DIR/function.pcm.
+
+foreach (var COMPILER COMPILER_ID SOURCE_DIR MAIN WORK_DIR)
+  if (NOT DEFINED ${var})
+    message(FATAL_ERROR "${var} is not set")
+  endif()
+endforeach()
+
+separate_arguments(flags UNIX_COMMAND "${FLAGS}")
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+# step(<description> <arguments...>) runs the compiler in WORK_DIR
+function(step description)
+  execute_process(
+    COMMAND ${COMPILER} -std=c++20 ${flags} ${ARGN}
+    WORKING_DIRECTORY ${WORK_DIR}
+    RESULT_VARIABLE result
+    ERROR_VARIABLE error)
+  if (NOT result EQUAL 0)
+    message(FATAL_ERROR "Failed to ${description}:\n${error}")
+  endif()
+endfunction()
+
+set(interface ${SOURCE_DIR}/function.cppm)
+if (COMPILER_ID MATCHES "Clang")
+  step("precompile ${interface}" -I${SOURCE_DIR} --precompile -x c++-module
+       ${interface} -o function.pcm)
+  step("compile function.pcm" -c function.pcm -o function.o)
+  step("compile ${MAIN}" -fmodule-file=function=function.pcm -c ${MAIN}
+       -o main.o)
+else()
+  step("compile ${interface}" -fmodules-ts -I${SOURCE_DIR} -x c++
+       -c ${interface} -o function.o)
+  step("compile ${MAIN}" -fmodules-ts -c ${MAIN} -o main.o)
+endif()
+step("link" main.o function.o -o module_tests)
+
+execute_process(
+  COMMAND ${WORK_DIR}/module_tests
+  RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+  message(FATAL_ERROR "module_tests failed: ${result}")
+endif()
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "arena_record.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cleanup_impl {
+
+// Precedes every action on the stack, the action follows at the next
+// suitably aligned address
+struct record {
+  // arena_impl::consume of the action, takes the address past the record
+  void (*consume)(void* after, bool call);
+  record* below;
+  // Chunk of the record and its offset in there, the top of the stack goes
+  // back to them when the record is popped
+  std::uint16_t chunk;
+  bool trivial;
+  std::uint32_t offset;
+};
+} // namespace cleanup_impl
+
+// Stack of cleanup actions of any callable type, for instance the rollback
+// steps of a transaction. Actions are emplaced into an arena whose first
+// `N` bytes are part of the object, further chunks double in size and are
+// kept until destruction. Pending actions run in reverse order of pushing
+// on run() or when the stack is destroyed, commit() drops them without
+// calling them. Actions must not push onto the stack that runs them.
+template <std::size_t N = 256>
+class cleanup_stack {
+  using record = cleanup_impl::record;
+
+public:
+  cleanup_stack() noexcept = default;
+
+  cleanup_stack(cleanup_stack const&) = delete;
+  cleanup_stack& operator=(cleanup_stack const&) = delete;
+
+  // An action throwing here terminates
+  ~cleanup_stack() {
+    while (top != nullptr) {
+      pop(true);
+    }
+  }
+
+  template <typename F>
+  void push(F&& action) {
+    using action_t = std::decay_t<F>;
+    std::size_t chunk = current;
+    std::size_t offset = used;
+    record* r = allocate(sizeof(action_t), alignof(action_t));
+    try {
+      new (arena_impl::object_address(r, alignof(action_t)))
+          action_t(std::forward<F>(action));
+    } catch (...) {
+      current = chunk;
+      used = offset;
+      throw;
+    }
+    top = new (r) record{&arena_impl::consume<action_t>, top,
+                         static_cast<std::uint16_t>(current),
+                         std::is_trivially_destructible_v<action_t>,
+                         static_cast<std::uint32_t>(
+                             reinterpret_cast<unsigned char*>(r) -
+                             chunk_data(current))};
+    ++count;
+    nontrivial += top->trivial ? 0 : 1;
+  }
+
+  std::size_t size() const noexcept {
+    return count;
+  }
+
+  bool empty() const noexcept {
+    return count == 0;
+  }
+
+  // Calls every pending action, the last pushed first. The actions below a
+  // throwing one still run, the first exception is rethrown afterwards.
+  void run() {
+    std::exception_ptr error;
+    while (top != nullptr) {
+      try {
+        pop(true);
+      } catch (...) {
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+  // Drops every pending action without calling it. Free when all of them are
+  // trivially destructible.
+  void commit() noexcept {
+    if (nontrivial == 0) {
+      top = nullptr;
+      count = 0;
+      current = 0;
+      used = 0;
+      return;
+    }
+    while (top != nullptr) {
+      pop(false);
+    }
+  }
+
+  // Drops the last pushed action without calling it
+  void release() noexcept {
+    if (top != nullptr) {
+      pop(false);
+    }
+  }
+
+private:
+  struct chunk_t {
+    std::unique_ptr<unsigned char[]> data;
+    std::size_t size;
+  };
+
+  unsigned char* chunk_data(std::size_t chunk) noexcept {
+    return chunk == 0 ? buffer : chunks[chunk - 1].data.get();
+  }
+
+  std::size_t chunk_size(std::size_t chunk) const noexcept {
+    return chunk == 0 ? N : chunks[chunk - 1].size;
+  }
+
+  // Room for a record followed by an object of `size` bytes aligned to
+  // `align` at the top of the stack. Starts a chunk if the current one is
+  // full.
+  record* allocate(std::size_t size, std::size_t align) {
+    for (;;) {
+      auto base = reinterpret_cast<std::uintptr_t>(chunk_data(current));
+      auto [offset, end] =
+          arena_impl::place<record>(base, used, size, align);
+      if (end <= chunk_size(current)) {
+        used = end;
+        return reinterpret_cast<record*>(base + offset);
+      }
+      std::size_t needed = alignof(record) + sizeof(record) + align + size;
+      if (current == chunks.size() || chunk_size(current + 1) < needed) {
+        std::size_t grown =
+            std::max(2 * std::max(chunk_size(current), N), needed);
+        chunks.insert(chunks.begin() + current,
+                      chunk_t{std::make_unique<unsigned char[]>(grown),
+                              grown});
+      }
+      ++current;
+      used = 0;
+    }
+  }
+
+  // The top of the stack moves below the record first, so the record is
+  // gone even if the call throws
+  void pop(bool call) {
+    record* r = top;
+    top = r->below;
+    current = r->chunk;
+    used = r->offset;
+    --count;
+    nontrivial -= r->trivial ? 0 : 1;
+    r->consume(r + 1, call);
+  }
+
+  alignas(std::max_align_t) unsigned char buffer[N];
+  std::vector<chunk_t> chunks;
+  record* top{nullptr};
+  // Chunk of the top of the stack, 0 is `buffer`, and the bytes used in it
+  std::size_t current{0};
+  std::size_t used{0};
+  std::size_t count{0};
+  std::size_t nontrivial{0};
+};
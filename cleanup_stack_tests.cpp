@@ -0,0 +1,134 @@
+#include "alloc_counter.h"
+#include "cleanup_stack.h"
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+TEST(cleanup_stack_test, runs_in_reverse_on_destruction) {
+  std::vector<int> log;
+  {
+    cleanup_stack<> stack;
+    for (int i = 0; i < 3; ++i) {
+      stack.push([&log, i] { log.push_back(i); });
+    }
+    EXPECT_EQ(3u, stack.size());
+    EXPECT_TRUE(log.empty());
+  }
+  EXPECT_EQ((std::vector<int>{2, 1, 0}), log);
+}
+
+TEST(cleanup_stack_test, commit_and_release) {
+  auto token = std::make_shared<int>(0);
+  int runs = 0;
+  {
+    cleanup_stack<> stack;
+    stack.push([&runs] { ++runs; });
+    stack.push([token] {});
+    stack.push([&runs] { runs += 10; });
+    EXPECT_EQ(2, token.use_count());
+
+    stack.release();
+    EXPECT_EQ(2u, stack.size());
+    stack.commit();
+    EXPECT_TRUE(stack.empty());
+    EXPECT_EQ(1, token.use_count());
+
+    stack.push([&runs] { runs += 100; });
+    stack.push([&runs] { runs += 1000; });
+    stack.commit();
+  }
+  EXPECT_EQ(0, runs);
+}
+
+TEST(cleanup_stack_test, run_continues_after_throw) {
+  cleanup_stack<> stack;
+  std::vector<int> log;
+  stack.push([&log] { log.push_back(0); });
+  stack.push([] { throw std::runtime_error("first"); });
+  stack.push([&log] { log.push_back(2); });
+  stack.push([] { throw std::logic_error("last"); });
+  EXPECT_THROW(stack.run(), std::logic_error);
+  EXPECT_EQ((std::vector<int>{2, 0}), log);
+  EXPECT_TRUE(stack.empty());
+}
+
+TEST(cleanup_stack_test, throwing_construction_keeps_stack) {
+  struct throwing {
+    throwing() = default;
+    throwing(throwing const&) {
+      throw std::runtime_error("copy");
+    }
+    void operator()() const {}
+  };
+
+  cleanup_stack<64> stack;
+  int runs = 0;
+  stack.push([&runs] { ++runs; });
+  throwing t;
+  EXPECT_THROW(stack.push(t), std::runtime_error);
+  EXPECT_EQ(1u, stack.size());
+  stack.run();
+  EXPECT_EQ(1, runs);
+}
+
+TEST(cleanup_stack_test, spills_into_chunks) {
+  struct alignas(64) aligned {
+    void operator()() const {
+      bool ok = reinterpret_cast<std::uintptr_t>(this) % 64 == 0;
+      log->push_back(ok ? -1 : -2);
+    }
+
+    std::vector<int>* log;
+  };
+
+  std::vector<int> log;
+  std::vector<int> expected;
+  cleanup_stack<64> stack;
+  for (int i = 0; i < 50; ++i) {
+    if (i % 10 == 0) {
+      std::array<int, 100> big{};
+      big.back() = i;
+      stack.push([&log, big] { log.push_back(big.back()); });
+    } else if (i % 10 == 5) {
+      stack.push(aligned{&log});
+    } else {
+      stack.push([&log, i] { log.push_back(i); });
+    }
+    expected.insert(expected.begin(), i % 10 == 5 ? -1 : i);
+  }
+  stack.run();
+  EXPECT_EQ(expected, log);
+}
+
+TEST(cleanup_stack_test, inline_and_reused_chunks_do_not_allocate) {
+  int sum = 0;
+  {
+    alloc_counter::guard guard;
+    cleanup_stack<> stack;
+    for (int i = 0; i < 6; ++i) {
+      stack.push([&sum, i] { sum += i; });
+    }
+    stack.run();
+    EXPECT_EQ(0, guard.allocations());
+  }
+
+  cleanup_stack<64> stack;
+  auto fill = [&] {
+    for (int i = 0; i < 100; ++i) {
+      stack.push([&sum, i] { sum += i; });
+    }
+  };
+  fill();
+  stack.commit();
+  alloc_counter::guard guard;
+  fill();
+  stack.run();
+  fill();
+  stack.commit();
+  EXPECT_EQ(0, guard.allocations());
+  EXPECT_EQ(15 + 4950, sum);
+}
@@ -0,0 +1,131 @@
+# Compiles SOURCE to assembly and verifies the FileCheck-style directives
+# written in its comments against the generated code. Usage:
+#
+#   cmake -DCOMPILER=<c++> -DFLAGS=<flags> -DSOURCE=<probes.cpp>
+#         -DOUTPUT=<probes.s> -DPREFIXES=<CHECK,GCC> -P check_asm.cmake
+#
+# Every directive belongs to the function named by the preceding LABEL and
+# is only checked inside that function's body:
+#
+#   // <PREFIX>-LABEL: name         starts the checks of function `name`
+#   // <PREFIX>: text               `text` occurs after the previous match
+#   // <PREFIX>-NOT: text           `text` does not occur at all
+#   // <PREFIX>-COUNT: n text       `text` occurs on exactly n lines
+#   // <PREFIX>-INSNS-MAX: n        the function has at most n instructions
+#
+# Patterns are plain substrings matched against instruction lines with runs
+# of whitespace collapsed to a single space.
+
+foreach (var COMPILER SOURCE OUTPUT PREFIXES)
+  if (NOT DEFINED ${var})
+    message(FATAL_ERROR "${var} is not set")
+  endif()
+endforeach()
+
+separate_arguments(flags UNIX_COMMAND "${FLAGS}")
+execute_process(
+  COMMAND ${COMPILER} ${flags} -S -o ${OUTPUT} ${SOURCE}
+  RESULT_VARIABLE result
+  ERROR_VARIABLE error)
+if (NOT result EQUAL 0)
+  message(FATAL_ERROR "Failed to compile ${SOURCE}:\n${error}")
+endif()
+
+# Collects the instructions of every function into asm_<name>
+file(STRINGS ${OUTPUT} asm_lines)
+set(current "")
+foreach (line IN LISTS asm_lines)
+  if (line MATCHES "^([A-Za-z_][A-Za-z0-9_]*):")
+    set(current ${CMAKE_MATCH_1})
+    set(asm_${current} "")
+  elseif (current AND line MATCHES "^[ \t]+\\.size[ \t]+${current},")
+    set(current "")
+  elseif (current AND line MATCHES "^[ \t]+[a-z]")
+    string(REGEX REPLACE "[ \t]+" " " line "${line}")
+    string(STRIP "${line}" line)
+    list(APPEND asm_${current} "${line}")
+  endif()
+endforeach()
+
+string(REPLACE "," "|" prefix_regex "${PREFIXES}")
+file(STRINGS ${SOURCE} source_lines REGEX "^// (${prefix_regex})[-A-Z]*:")
+
+set(failures 0)
+macro(fail msg)
+  string(JOIN "\n  " listing ${body})
+  message(SEND_ERROR "${label}: ${msg}\n  ${listing}")
+  math(EXPR failures "${failures} + 1")
+endmacro()
+
+set(label "")
+foreach (line IN LISTS source_lines)
+  if (NOT line MATCHES "^// (${prefix_regex})(-[A-Z-]+)?: *(.*)$")
+    continue()
+  endif()
+  set(kind "${CMAKE_MATCH_2}")
+  set(arg "${CMAKE_MATCH_3}")
+
+  if (kind STREQUAL "-LABEL")
+    set(label "${arg}")
+    if (NOT DEFINED asm_${label})
+      fail("function not found in the generated assembly")
+    endif()
+    set(body "${asm_${label}}")
+    set(position 0)
+    continue()
+  endif()
+  if (NOT label)
+    message(FATAL_ERROR "Directive before the first LABEL: ${line}")
+  endif()
+
+  if (kind STREQUAL "")
+    list(LENGTH body size)
+    set(found FALSE)
+    while (position LESS size)
+      list(GET body ${position} insn)
+      math(EXPR position "${position} + 1")
+      string(FIND "${insn}" "${arg}" index)
+      if (index GREATER_EQUAL 0)
+        set(found TRUE)
+        break()
+      endif()
+    endwhile()
+    if (NOT found)
+      fail("expected '${arg}'")
+    endif()
+  elseif (kind STREQUAL "-NOT")
+    foreach (insn IN LISTS body)
+      string(FIND "${insn}" "${arg}" index)
+      if (index GREATER_EQUAL 0)
+        fail("unexpected '${arg}' in '${insn}'")
+      endif()
+    endforeach()
+  elseif (kind STREQUAL "-COUNT")
+    if (NOT arg MATCHES "^([0-9]+) (.*)$")
+      message(FATAL_ERROR "Malformed directive: ${line}")
+    endif()
+    set(expected ${CMAKE_MATCH_1})
+    set(pattern "${CMAKE_MATCH_2}")
+    set(count 0)
+    foreach (insn IN LISTS body)
+      string(FIND "${insn}" "${pattern}" index)
+      if (index GREATER_EQUAL 0)
+        math(EXPR count "${count} + 1")
+      endif()
+    endforeach()
+    if (NOT count EQUAL expected)
+      fail("expected ${expected} lines with '${pattern}', found ${count}")
+    endif()
+  elseif (kind STREQUAL "-INSNS-MAX")
+    list(LENGTH body size)
+    if (size GREATER arg)
+      fail("${size} instructions, at most ${arg} expected")
+    endif()
+  else()
+    message(FATAL_ERROR "Unknown directive: ${line}")
+  endif()
+endforeach()
+
+if (failures GREATER 0)
+  message(FATAL_ERROR "${failures} codegen check(s) failed, see ${OUTPUT}")
+endif()
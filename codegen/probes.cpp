@@ -0,0 +1,115 @@
+// Probe functions whose generated code is checked by check_asm.cmake. They
+// have C linkage so that labels in the assembly match the names below.
+#include "function.h"
+
+using func_t = function<int(int)>;
+using desc_t = function_impl::type_descriptor<int, int>;
+using storage_t = function_impl::storage<int, int>;
+
+struct small_target {
+  int operator()(int x) const {
+    return *value + x;
+  }
+
+  int* value;
+};
+
+struct large_target {
+  int operator()(int x) const {
+    return payload[0] + x;
+  }
+
+  int payload[16];
+};
+
+// Invocation is a load of the descriptor and a tail jump to its thunk
+// CHECK-LABEL: invoke_probe
+// CHECK-INSNS-MAX: 2
+// CHECK: (%rdi)
+// CHECK: jmp
+// CHECK-NOT: call
+extern "C" int invoke_probe(func_t& f, int x) {
+  return f(x);
+}
+
+// CHECK-LABEL: operator_bool_probe
+// CHECK-INSNS-MAX: 4
+// CHECK-NOT: call
+// CHECK-NOT: jmp
+extern "C" bool operator_bool_probe(func_t const& f) {
+  return static_cast<bool>(f);
+}
+
+// CHECK-LABEL: move_construct_probe
+// CHECK-INSNS-MAX: 5
+// CHECK-COUNT: 1 *
+// CHECK-NOT: call
+extern "C" void move_construct_probe(func_t* dst, func_t& src) {
+  new (dst) func_t(std::move(src));
+}
+
+// Move assignment takes the new target out before destroying the old one,
+// which may own it. Relocatable targets only cost the destroy call, others
+// move through a temporary: two move thunk calls, the destroy call and the
+// temporary's destructor.
+// CHECK-LABEL: move_assign_probe
+// CHECK-COUNT: 5 *
+extern "C" void move_assign_probe(func_t& dst, func_t& src) {
+  dst = std::move(src);
+}
+
+// Relocatable targets are swapped without thunk calls, the rest pays for
+// three moves and destroying the temporary
+// CHECK-LABEL: swap_probe
+// CHECK-COUNT: 4 *
+extern "C" void swap_probe(func_t& lhs, func_t& rhs) {
+  lhs.swap(rhs);
+}
+
+// Relocating a small target copies the buffer without calling other thunks
+// CHECK-LABEL: small_move_thunk_probe
+// CHECK-INSNS-MAX: 8
+// CHECK-NOT: *
+// CHECK-NOT: call
+extern "C" void small_move_thunk_probe(storage_t* dst, storage_t* src) {
+  desc_t::get_descriptor<small_target>()->move(dst, src);
+}
+
+// CHECK-LABEL: large_move_thunk_probe
+// CHECK-INSNS-MAX: 8
+// CHECK-NOT: *
+// CHECK-NOT: call
+extern "C" void large_move_thunk_probe(storage_t* dst, storage_t* src) {
+  desc_t::get_descriptor<large_target>()->move(dst, src);
+}
+
+// CHECK-LABEL: small_invoke_thunk_probe
+// CHECK-INSNS-MAX: 4
+// CHECK-NOT: call
+extern "C" int small_invoke_thunk_probe(storage_t* s, int x) {
+  return desc_t::get_descriptor<small_target>()->invoke(s, x);
+}
+
+// CHECK-LABEL: large_invoke_thunk_probe
+// CHECK-INSNS-MAX: 4
+// CHECK-NOT: call
+extern "C" int large_invoke_thunk_probe(storage_t* s, int x) {
+  return desc_t::get_descriptor<large_target>()->invoke(s, x);
+}
+
+struct visitor {
+  void operator()(small_target&);
+  void operator()(large_target&);
+  void operator()(int (*&)(int));
+};
+
+// Visiting hashes the descriptor into the table of the candidates, compares
+// it with the single entry found there and calls the visitor through the
+// thunk at that position: one comparison whatever the number of candidates
+// CHECK-LABEL: visit_probe
+// CHECK: imul
+// CHECK-COUNT: 1 cmp
+// CHECK-COUNT: 1 call *
+extern "C" bool visit_probe(func_t& f, visitor& v) {
+  return f.visit<small_target, large_target, int (*)(int)>(v);
+}
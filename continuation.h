@@ -0,0 +1,91 @@
+#pragma once
+
+#include "function.h"
+
+#include <type_traits>
+#include <utility>
+
+#if defined(__has_cpp_attribute)
+#if __has_cpp_attribute(clang::musttail)
+#define CONTINUATION_MUSTTAIL [[clang::musttail]]
+#endif
+#endif
+
+namespace continuation_impl {
+// Arguments travel unchanged through every hop, so with a guaranteed tail
+// call they have to be passed in registers or on the caller's frame as is
+template <typename... Args>
+inline constexpr bool tail_callable =
+    ((std::is_reference_v<Args> || std::is_trivially_copyable_v<Args>) && ...);
+} // namespace continuation_impl
+
+// One step of a continuation-passing chain: invoking it does some work and
+// returns the step to run next, or an empty continuation to stop. Steps never
+// call each other directly, `run` drives the chain, so arbitrarily long chains
+// run in constant stack.
+template <typename... Args>
+class continuation {
+public:
+  continuation() = default;
+
+  template <typename F, typename = std::enable_if_t<
+                            !std::is_same_v<std::decay_t<F>, continuation>>>
+  continuation(F f) : step(std::move(f)) {
+#if defined(CONTINUATION_MUSTTAIL)
+    if constexpr (continuation_impl::tail_callable<Args...>) {
+      hop = &hop_from<F>;
+    }
+#endif
+  }
+
+  // Runs this step only and returns the next one
+  continuation operator()(Args... args) {
+    return step(std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const noexcept {
+    return static_cast<bool>(step);
+  }
+
+private:
+  template <typename... As, typename... Ts>
+  friend void run(continuation<As...> first, Ts&&... args);
+
+#if defined(CONTINUATION_MUSTTAIL)
+  // Calls the F stored in `slot`, replaces it with the step it returns and
+  // jumps to that step's thunk, so every hop is one call of the step plus
+  // one indirect jump and the stack does not grow
+  template <typename F>
+  static void hop_from(continuation* slot, Args... args) {
+    *slot = (*slot->step.template target<F>())(args...);
+    if (!*slot) {
+      return;
+    }
+    CONTINUATION_MUSTTAIL return slot->hop(slot, args...);
+  }
+
+  void (*hop)(continuation*, Args...){nullptr};
+#endif
+
+  function<continuation(Args...)> step;
+};
+
+// Runs `first` and every continuation it hands over to until one of them is
+// empty. Where the compiler guarantees tail calls and the arguments allow
+// them, the steps' thunks jump from one to the next; otherwise this is a
+// trampoline: each step returns to the loop, which calls the next one.
+// Either way the stack does not grow with the length of the chain.
+template <typename... Args, typename... Ts>
+void run(continuation<Args...> first, Ts&&... args) {
+#if defined(CONTINUATION_MUSTTAIL)
+  if constexpr (continuation_impl::tail_callable<Args...>) {
+    if (first) {
+      first.hop(&first, std::forward<Ts>(args)...);
+    }
+    return;
+  }
+#endif
+  while (first) {
+    first = first(args...);
+  }
+}
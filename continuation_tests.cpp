@@ -0,0 +1,117 @@
+#include "continuation.h"
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <pthread.h>
+
+namespace {
+struct countdown {
+  continuation<int&> operator()(int& n) const {
+    if (--n == 0) {
+      return {};
+    }
+    return *this;
+  }
+};
+
+// Remembers the frame of every hop, a growing stack shows up as different
+// addresses
+struct frame_recorder {
+  continuation<std::vector<void*>&> operator()(std::vector<void*>& frames) {
+    frames.push_back(__builtin_frame_address(0));
+    if (frames.size() == 1000) {
+      return {};
+    }
+    return *this;
+  }
+};
+
+struct large_step {
+  continuation<std::string&> operator()(std::string& trace) const {
+    trace += label[0];
+    if (trace.size() == 3) {
+      return {};
+    }
+    return large_step{{static_cast<char>(label[0] + 1)}};
+  }
+
+  char label[32];
+};
+} // namespace
+
+TEST(continuation_test, empty) {
+  int n = 0;
+  run(continuation<int&>(), n);
+  EXPECT_EQ(0, n);
+}
+
+TEST(continuation_test, single_hop) {
+  int n = 3;
+  continuation<int&> step = countdown();
+  continuation<int&> next = step(n);
+  EXPECT_EQ(2, n);
+  EXPECT_TRUE(static_cast<bool>(next));
+}
+
+TEST(continuation_test, deep_chain) {
+  int n = 1'000'000;
+  run(continuation<int&>(countdown()), n);
+  EXPECT_EQ(0, n);
+}
+
+// Runs `f` on a thread with a stack of `bytes`, far too small for one frame
+// per hop of a long chain
+template <typename F>
+void with_stack(std::size_t bytes, F f) {
+  pthread_attr_t attr;
+  ASSERT_EQ(0, pthread_attr_init(&attr));
+  ASSERT_EQ(0, pthread_attr_setstacksize(&attr, bytes));
+  pthread_t thread;
+  auto body = [](void* arg) -> void* {
+    (*static_cast<F*>(arg))();
+    return nullptr;
+  };
+  ASSERT_EQ(0, pthread_create(&thread, &attr, body, &f));
+  pthread_join(thread, nullptr);
+  pthread_attr_destroy(&attr);
+}
+
+TEST(continuation_test, small_stack) {
+  int n = 1'000'000;
+  with_stack(256 * 1024, [&n] { run(continuation<int&>(countdown()), n); });
+  EXPECT_EQ(0, n);
+}
+
+TEST(continuation_test, constant_stack) {
+  std::vector<void*> frames;
+  frames.reserve(1000);
+  run(continuation<std::vector<void*>&>(frame_recorder()), frames);
+  ASSERT_EQ(1000u, frames.size());
+  // The first hop may be inlined into run() and have a frame of its own
+  EXPECT_EQ(frames[1], frames.back());
+}
+
+TEST(continuation_test, large_steps) {
+  std::string trace;
+  run(continuation<std::string&>(large_step{{'a'}}), trace);
+  EXPECT_EQ("abc", trace);
+}
+
+TEST(continuation_test, non_trivial_arguments) {
+  std::vector<std::string> seen;
+  struct step {
+    continuation<std::vector<std::string>*, std::string>
+    operator()(std::vector<std::string>* out, std::string s) const {
+      out->push_back(s);
+      if (out->size() == 2) {
+        return {};
+      }
+      return *this;
+    }
+  };
+  run(continuation<std::vector<std::string>*, std::string>(step()), &seen,
+      std::string("x"));
+  EXPECT_EQ((std::vector<std::string>{"x", "x"}), seen);
+}
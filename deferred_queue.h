@@ -0,0 +1,200 @@
+#pragma once
+
+#include "arena_record.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace deferred_impl {
+
+// Precedes every callable in an arena
+struct record {
+  // arena_impl::consume of the callable, takes the address past the record
+  void (*consume)(void* after, bool call);
+  // Offset in the chunk past the callable
+  std::size_t end;
+};
+
+// Sequence of callables stored back to back in chunks of memory. Clearing
+// keeps the chunks, so an arena that is refilled with a similar load does
+// not allocate again.
+class arena {
+public:
+  explicit arena(std::size_t chunk_size) : chunk_size(chunk_size) {}
+
+  arena(arena const&) = delete;
+  arena& operator=(arena const&) = delete;
+
+  ~arena() {
+    consume_all(false);
+  }
+
+  template <typename F, typename... Ts>
+  void emplace(Ts&&... args) {
+    record* r = allocate(sizeof(F), alignof(F));
+    new (arena_impl::object_address(r, alignof(F)))
+        F(std::forward<Ts>(args)...);
+    r->consume = &arena_impl::consume<F>;
+    chunks[current].used = r->end;
+    ++count;
+  }
+
+  std::size_t size() const noexcept {
+    return count;
+  }
+
+  // Bytes held by the chunks
+  std::size_t capacity() const noexcept {
+    std::size_t result = 0;
+    for (auto const& c : chunks) {
+      result += c.capacity;
+    }
+    return result;
+  }
+
+  // Calls the callables in insertion order and clears the arena. If one of
+  // them throws, the remaining ones are destroyed without being called.
+  void run() {
+    consume_all(true);
+  }
+
+  void clear() noexcept {
+    consume_all(false);
+  }
+
+private:
+  struct chunk {
+    std::unique_ptr<unsigned char[]> data;
+    std::size_t capacity;
+    std::size_t used;
+    // Offset of the first record not consumed yet
+    std::size_t begin;
+  };
+
+  static std::uintptr_t base(chunk const& c) noexcept {
+    return reinterpret_cast<std::uintptr_t>(c.data.get());
+  }
+
+  // Room for a record followed by an object of `size` bytes aligned to
+  // `align`, at the end of the current chunk or in a following one. The
+  // room is taken once the object is constructed.
+  record* allocate(std::size_t size, std::size_t align) {
+    for (; current < chunks.size(); ++current) {
+      chunk& c = chunks[current];
+      auto [offset, end] =
+          arena_impl::place<record>(base(c), c.used, size, align);
+      if (end <= c.capacity) {
+        auto* r = reinterpret_cast<record*>(base(c) + offset);
+        r->end = end;
+        return r;
+      }
+      if (c.used == 0) {
+        // Too small for this callable even when empty
+        break;
+      }
+    }
+    std::size_t needed = sizeof(record) + align + size;
+    std::size_t capacity = std::max(chunk_size, needed);
+    chunks.insert(chunks.begin() + current,
+                  chunk{std::make_unique<unsigned char[]>(capacity), capacity,
+                        0, 0});
+    return allocate(size, align);
+  }
+
+  void consume_all(bool call) {
+    struct reset {
+      ~reset() {
+        for (; i < a.chunks.size(); ++i) {
+          consume_chunk(a.chunks[i], false);
+        }
+        a.current = 0;
+        a.count = 0;
+      }
+
+      arena& a;
+      std::size_t i;
+    } guard{*this, 0};
+    if (call) {
+      for (; guard.i < chunks.size(); ++guard.i) {
+        consume_chunk(chunks[guard.i], true);
+      }
+    }
+  }
+
+  // Consumes the records of `c` that are left and marks the chunk empty.
+  // A record is skipped before it is consumed, so after a throwing call the
+  // chunk resumes at the next one.
+  static void consume_chunk(chunk& c, bool call) {
+    while (c.begin < c.used) {
+      std::uintptr_t next = base(c) + c.begin;
+      auto* r = reinterpret_cast<record*>(
+          next + arena_impl::padding(next, alignof(record)));
+      c.begin = r->end;
+      r->consume(r + 1, call);
+    }
+    c.begin = 0;
+    c.used = 0;
+  }
+
+  std::size_t chunk_size;
+  std::vector<chunk> chunks;
+  // First chunk with free space
+  std::size_t current{0};
+  std::size_t count{0};
+};
+} // namespace deferred_impl
+
+// Calls deferred to the end of a tick. Callables are emplaced back to back
+// into the back arena, tick() swaps the arenas and runs the calls of the
+// front one in order, which may defer calls for the next tick. The arenas
+// keep their memory, so a steady load of deferred calls does not allocate.
+class deferred_queue {
+public:
+  static constexpr std::size_t default_chunk_size = 16 * 1024;
+
+  explicit deferred_queue(std::size_t chunk_size = default_chunk_size)
+      : arenas{deferred_impl::arena(chunk_size),
+               deferred_impl::arena(chunk_size)} {}
+
+  template <typename F>
+  void defer(F&& f) {
+    back().template emplace<std::decay_t<F>>(std::forward<F>(f));
+  }
+
+  // Calls deferred since the last tick
+  std::size_t size() const noexcept {
+    return arenas[back_index].size();
+  }
+
+  // If a call throws, the remaining calls of the tick are destroyed without
+  // being called and the exception propagates
+  void tick() {
+    deferred_impl::arena& front = back();
+    back_index ^= 1;
+    front.run();
+  }
+
+  // Destroys the deferred calls without calling them
+  void clear() noexcept {
+    back().clear();
+  }
+
+  // Bytes held by both arenas
+  std::size_t capacity() const noexcept {
+    return arenas[0].capacity() + arenas[1].capacity();
+  }
+
+private:
+  deferred_impl::arena& back() noexcept {
+    return arenas[back_index];
+  }
+
+  deferred_impl::arena arenas[2];
+  std::size_t back_index{0};
+};
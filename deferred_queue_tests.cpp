@@ -0,0 +1,122 @@
+#include "alloc_counter.h"
+#include "deferred_queue.h"
+#include "function.h"
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+TEST(deferred_queue_test, runs_at_tick_in_order) {
+  deferred_queue queue;
+  std::vector<int> log;
+  for (int i = 0; i < 3; ++i) {
+    queue.defer([&log, i] { log.push_back(i); });
+  }
+  EXPECT_EQ(3u, queue.size());
+  EXPECT_TRUE(log.empty());
+  queue.tick();
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), log);
+  EXPECT_EQ(0u, queue.size());
+}
+
+TEST(deferred_queue_test, deferred_while_running_is_next_tick) {
+  deferred_queue queue;
+  int runs = 0;
+  queue.defer([&] {
+    ++runs;
+    queue.defer([&] { ++runs; });
+  });
+  queue.tick();
+  EXPECT_EQ(1, runs);
+  EXPECT_EQ(1u, queue.size());
+  queue.tick();
+  EXPECT_EQ(2, runs);
+}
+
+TEST(deferred_queue_test, destroys_targets) {
+  auto token = std::make_shared<int>(0);
+  {
+    deferred_queue queue;
+    queue.defer([token] {});
+    queue.tick();
+    EXPECT_EQ(1, token.use_count());
+
+    queue.defer([token] {});
+    queue.clear();
+    EXPECT_EQ(1, token.use_count());
+    EXPECT_EQ(0u, queue.size());
+
+    queue.defer([token] {});
+    EXPECT_EQ(2, token.use_count());
+  }
+  EXPECT_EQ(1, token.use_count());
+}
+
+TEST(deferred_queue_test, throwing_call_drops_the_rest) {
+  deferred_queue queue(64);
+  auto token = std::make_shared<int>(0);
+  int runs = 0;
+  queue.defer([&runs] { ++runs; });
+  queue.defer([] { throw std::runtime_error("tick"); });
+  for (int i = 0; i < 10; ++i) {
+    queue.defer([&runs, token] { ++runs; });
+  }
+  EXPECT_THROW(queue.tick(), std::runtime_error);
+  EXPECT_EQ(1, runs);
+  EXPECT_EQ(1, token.use_count());
+
+  queue.defer([&runs] { ++runs; });
+  queue.tick();
+  EXPECT_EQ(2, runs);
+}
+
+TEST(deferred_queue_test, large_and_over_aligned) {
+  struct alignas(64) aligned {
+    void operator()() const {
+      *ok = reinterpret_cast<std::uintptr_t>(this) % 64 == 0;
+    }
+
+    bool* ok;
+  };
+
+  deferred_queue queue(128);
+  std::array<int, 256> big{};
+  big.back() = 7;
+  int seen = 0;
+  bool ok = false;
+  queue.defer([&seen] { ++seen; });
+  queue.defer([big, &seen] { seen += big.back(); });
+  queue.defer(aligned{&ok});
+  function<void()> f = [&seen] { seen += 100; };
+  queue.defer(std::move(f));
+  queue.tick();
+  EXPECT_EQ(108, seen);
+  EXPECT_TRUE(ok);
+}
+
+TEST(deferred_queue_test, steady_state_does_not_allocate) {
+  deferred_queue queue(1024);
+  std::uint64_t sum = 0;
+  auto fill = [&] {
+    for (std::uint64_t i = 0; i < 1000; ++i) {
+      queue.defer([&sum, i] { sum += i; });
+    }
+  };
+  fill();
+  queue.tick();
+  fill();
+  queue.tick();
+  std::size_t capacity = queue.capacity();
+
+  alloc_counter::guard guard;
+  for (int tick = 0; tick < 10; ++tick) {
+    fill();
+    queue.tick();
+  }
+  EXPECT_EQ(0, guard.allocations());
+  EXPECT_EQ(capacity, queue.capacity());
+  EXPECT_EQ(12 * 499'500u, sum);
+}
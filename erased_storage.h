@@ -0,0 +1,195 @@
+#pragma once
+
+#include "function.h"
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// Type-erased storage without a call part for inline_poly and any_value: the
+// storage engine of function with a descriptor of copy, move and destroy
+// thunks only and a small buffer of configurable size.
+namespace erased_impl {
+
+template <std::size_t Size, std::size_t Align>
+struct storage;
+
+// The ids of function, so that target_type_id<T>() identifies T in both
+using function_impl::type_tag;
+
+template <typename T, std::size_t Size, std::size_t Align>
+inline constexpr bool fits_small =
+    sizeof(T) <= Size && Align % alignof(T) == 0 &&
+    std::is_nothrow_move_constructible_v<T>;
+
+template <std::size_t Size, std::size_t Align>
+struct descriptor {
+  using storage_t = storage<Size, Align>;
+
+  // Null if the type is not copy constructible
+  void (*copy)(storage_t*, storage_t const*);
+  void (*move)(storage_t*, storage_t*) noexcept;
+  void (*destroy)(storage_t*) noexcept;
+  // The object lives in the buffer rather than on the heap
+  bool small;
+  // The object can be relocated by copying the buffer bytes: it lives on the
+  // heap or is small and trivially copyable
+  bool relocatable;
+  std::string_view name;
+  // type_tag of the stored type, null if the storage is empty
+  void const* type;
+
+  template <typename T>
+  static constexpr descriptor make();
+
+  static constexpr descriptor make_empty();
+};
+
+template <typename Descriptor, typename T>
+inline constexpr Descriptor descriptor_for = Descriptor::template make<T>();
+
+template <typename Descriptor>
+inline constexpr Descriptor empty_descriptor = Descriptor::make_empty();
+
+// The buffer always has room for the heap pointer
+template <std::size_t Size>
+inline constexpr std::size_t buffer_size =
+    Size < sizeof(void*) ? sizeof(void*) : Size;
+
+template <std::size_t Align>
+inline constexpr std::size_t buffer_align =
+    Align < alignof(void*) ? alignof(void*) : Align;
+
+template <std::size_t Size, std::size_t Align>
+struct storage
+    : function_impl::basic_storage<
+          storage<Size, Align>, descriptor<Size, Align>,
+          std::aligned_storage_t<buffer_size<Size>, buffer_align<Align>>> {
+  using descriptor_t = descriptor<Size, Align>;
+
+  static constexpr std::size_t size = buffer_size<Size>;
+  static constexpr std::size_t align = buffer_align<Align>;
+
+  template <typename T>
+  static constexpr bool fits_small = erased_impl::fits_small<T, size, align>;
+
+  template <typename T>
+  static constexpr descriptor_t const* get_descriptor() noexcept {
+    return &descriptor_for<descriptor_t, T>;
+  }
+
+  static constexpr descriptor_t const* get_empty_descriptor() noexcept {
+    return &empty_descriptor<descriptor_t>;
+  }
+
+  ~storage() {
+    this->desc->destroy(this);
+  }
+
+  // Address of the stored object, null if empty
+  void* address() noexcept {
+    if (this->desc == get_empty_descriptor()) {
+      return nullptr;
+    }
+    return this->desc->small ? static_cast<void*>(&this->buffer)
+                             : *reinterpret_cast<void**>(&this->buffer);
+  }
+
+  void const* address() const noexcept {
+    return const_cast<storage*>(this)->address();
+  }
+
+  // Pre: empty. The descriptor is set last, so the storage stays empty if
+  // the construction throws.
+  template <typename T, typename... Ts>
+  T& emplace(Ts&&... args) {
+    assert(this->desc == get_empty_descriptor());
+    if constexpr (fits_small<T>) {
+      new (&this->buffer) T(std::forward<Ts>(args)...);
+    } else {
+      this->set(new T(std::forward<Ts>(args)...));
+    }
+    this->desc = get_descriptor<T>();
+    return *this->template get<T>();
+  }
+
+  // Pre: empty
+  void copy_from(storage const& other) {
+    assert(this->desc == get_empty_descriptor());
+    if (other.desc->copy == nullptr) {
+      throw std::logic_error("stored type is not copy constructible");
+    }
+    other.desc->copy(this, &other);
+  }
+};
+
+template <std::size_t Size, std::size_t Align>
+template <typename T>
+constexpr descriptor<Size, Align> descriptor<Size, Align>::make() {
+  constexpr bool small = storage_t::template fits_small<T>;
+  void (*copy)(storage_t*, storage_t const*) = nullptr;
+  if constexpr (std::is_copy_constructible_v<T>) {
+    copy = [](storage_t* dst, storage_t const* src) {
+      if constexpr (small) {
+        new (&dst->buffer) T(*src->template get<T>());
+      } else {
+        dst->set(new T(*src->template get<T>()));
+      }
+      dst->desc = src->desc;
+    };
+  }
+  return {
+      /* copy */
+      copy,
+      /* move */
+      [](storage_t* dst, storage_t* src) noexcept {
+        if constexpr (small) {
+          new (&dst->buffer) T(std::move(*src->template get<T>()));
+          src->template get<T>()->~T();
+        } else {
+          dst->set(src->template get<T>());
+        }
+        dst->desc = src->desc;
+        src->desc = storage_t::get_empty_descriptor();
+      },
+      /* destroy */
+      [](storage_t* dst) noexcept {
+        if constexpr (small) {
+          dst->template get<T>()->~T();
+        } else {
+          delete dst->template get<T>();
+        }
+      },
+      /* small */
+      small,
+      /* relocatable */
+      !small || std::is_trivially_copyable_v<T>,
+      /* name */
+      function_impl::type_name<T>(),
+      /* type */
+      &type_tag<T>};
+}
+
+template <std::size_t Size, std::size_t Align>
+constexpr descriptor<Size, Align> descriptor<Size, Align>::make_empty() {
+  return {/* copy */
+          [](storage_t*, storage_t const*) {},
+          /* move */
+          [](storage_t*, storage_t*) noexcept {},
+          /* destroy */
+          [](storage_t*) noexcept {},
+          /* small */
+          true,
+          /* relocatable */
+          true,
+          /* name */
+          {},
+          /* type */
+          nullptr};
+}
+} // namespace erased_impl
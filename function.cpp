@@ -0,0 +1,16 @@
+// Explicit instantiations of the signatures declared extern in function.h
+#include "function.h"
+
+#define FUNCTION_INSTANTIATE(...)                                              \
+  template struct function_impl::type_descriptor<__VA_ARGS__>;                 \
+  template struct function_impl::storage<__VA_ARGS__>;
+FUNCTION_INSTANTIATE(void)
+FUNCTION_INSTANTIATE(void, int)
+FUNCTION_INSTANTIATE(bool)
+FUNCTION_INSTANTIATE(bool, int const&)
+#undef FUNCTION_INSTANTIATE
+
+template struct function<void()>;
+template struct function<void(int)>;
+template struct function<bool()>;
+template struct function<bool(int const&)>;
@@ -0,0 +1,21 @@
+// C++20 module interface: `import function;` instead of including
+// function.h. The header is attached to the module and exported as a whole;
+// the standard headers it needs stay in the global module fragment and have
+// to match the includes of function.h.
+module;
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+export module function;
+
+export {
+#include "function.h"
+}
@@ -1,8 +1,14 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
 #include <new>
 #include <stdexcept>
+#include <string_view>
+#include <tuple>
 #include <type_traits>
 #include <utility>
 
@@ -12,19 +18,203 @@ public:
       : std::runtime_error(str) {}
 };
 
+// Plain function pointer plus context for C APIs taking a `void*` user data
+// argument. `fn` has to be called with `ctx` as its first argument.
+template <typename R, typename... Args>
+struct c_callback_pair {
+  R (*fn)(void*, Args...);
+  void* ctx;
+
+  R operator()(Args... args) const {
+    return fn(ctx, std::forward<Args>(args)...);
+  }
+};
+
+// Policy for the extra parameters of `function`: small targets whose moves
+// may throw are stored inline instead of on the heap. The moves of `function`
+// stay noexcept, so a target move that does throw calls std::terminate.
+struct inline_throwing_moves {
+  // Not an operation, takes no entry in the operation table
+  using signature = void;
+};
+
 namespace function_impl {
 
 using container_t = std::aligned_storage_t<sizeof(void*), alignof(void*)>;
 
 template <typename T>
-static constexpr bool fits_small = (sizeof(T) <= sizeof(container_t) &&
+inline constexpr bool fits_small = (sizeof(T) <= sizeof(container_t) &&
                                     alignof(void*) % alignof(T) == 0 &&
                                     std::is_nothrow_move_constructible_v<T> &&
                                     std::is_nothrow_move_assignable_v<T>);
 
+// Declares T's moves noexcept, so that T qualifies for the small buffer
+template <typename T>
+struct nothrow_move : T {
+  explicit nothrow_move(T&& value) : T(std::move(value)) {}
+  nothrow_move(nothrow_move const&) = default;
+
+  nothrow_move(nothrow_move&& other) noexcept
+      : T(static_cast<T&&>(other)) {}
+
+  nothrow_move& operator=(nothrow_move const&) = default;
+
+  nothrow_move& operator=(nothrow_move&& other) noexcept {
+    T::operator=(static_cast<T&&>(other));
+    return *this;
+  }
+};
+
+template <typename T>
+struct unwrapped {
+  using type = T;
+};
+
+template <typename T>
+struct unwrapped<nothrow_move<T>> {
+  using type = T;
+};
+
+template <typename T>
+using unwrapped_t = typename unwrapped<T>::type;
+
+template <typename T>
+inline constexpr bool fits_small_if_nothrow =
+    std::is_class_v<T> && !std::is_final_v<T> && !fits_small<T> &&
+    sizeof(T) <= sizeof(container_t) && alignof(void*) % alignof(T) == 0;
+
+// Type that is actually stored for a target of type T
+template <typename T, typename... Ops>
+using stored_t = std::conditional_t<
+    (std::is_same_v<Ops, inline_throwing_moves> || ...) &&
+        fits_small_if_nothrow<T>,
+    nothrow_move<T>, T>;
+
+// Human-readable name of T, extracted from the compiler's pretty function
+// signature so that it is available under -fno-rtti as well
+template <typename T>
+constexpr std::string_view type_name() noexcept {
+#if defined(_MSC_VER)
+  std::string_view name = __FUNCSIG__;
+  std::size_t begin = name.find("type_name<") + 10;
+  std::size_t end = name.rfind(">(void)");
+#else
+  std::string_view name = __PRETTY_FUNCTION__;
+  std::size_t begin = name.find("T = ") + 4;
+  std::size_t end = name.find(';', begin);
+  if (end == std::string_view::npos) {
+    end = name.rfind(']');
+  }
+#endif
+  return name.substr(begin, end - begin);
+}
+
+// Distinct address per type, used as its id. Unlike the name, which is
+// shared by lambdas with the same signature defined in the same function,
+// the address cannot collide.
+template <typename T>
+inline constexpr char type_tag = 0;
+
+// Calls `target`, discarding its result if the signature returns void
+template <typename R, typename T, typename... Args>
+R invoke_target(T& target, Args&&... args) {
+  if constexpr (std::is_void_v<R>) {
+    target(std::forward<Args>(args)...);
+  } else {
+    return target(std::forward<Args>(args)...);
+  }
+}
+
+// True if `target.invoke_into(args...)` is well-formed
+template <typename Void, typename T, typename... Args>
+inline constexpr bool has_invoke_into = false;
+
+template <typename T, typename... Args>
+inline constexpr bool has_invoke_into<
+    std::void_t<decltype(std::declval<T&>().invoke_into(
+        std::declval<Args>()...))>,
+    T, Args...> = true;
+
 template <typename R, typename... Args>
 struct storage;
 
+// Type-erased entry of a user-defined operation. An operation is a type with
+// a `signature` alias and a static `call` that takes the target first:
+//
+//   struct size_hint {
+//     using signature = std::size_t();
+//
+//     template <typename T>
+//     static std::size_t call(T& target) {
+//       return target.size_hint();
+//     }
+//   };
+template <typename Storage, typename Op, typename Sig = typename Op::signature>
+struct op_thunk;
+
+template <typename Storage, typename Op, typename R, typename... Args>
+struct op_thunk<Storage, Op, R(Args...)> {
+  using type = R (*)(Storage*, Args...);
+
+  template <typename T>
+  static R call(Storage* storage, Args... args) {
+    return Op::call(static_cast<unwrapped_t<T>&>(*storage->template get<T>()),
+                    std::forward<Args>(args)...);
+  }
+
+  template <typename T>
+  static constexpr type entry = &call<T>;
+};
+
+// Policies keep a null entry
+template <typename Storage, typename Op>
+struct op_thunk<Storage, Op, void> {
+  using type = std::nullptr_t;
+
+  template <typename T>
+  static constexpr type entry = nullptr;
+};
+
+// A function type among the operations is an additional call signature
+template <typename Sig>
+struct invoke_op;
+
+template <typename R, typename... Args>
+struct invoke_op<R(Args...)> {
+  using signature = R(Args...);
+
+  template <typename T>
+  static R call(T& target, Args... args) {
+    return invoke_target<R>(target, std::forward<Args>(args)...);
+  }
+};
+
+template <typename Op>
+struct as_op {
+  using type = Op;
+};
+
+template <typename R, typename... Args>
+struct as_op<R(Args...)> {
+  using type = invoke_op<R(Args...)>;
+};
+
+template <typename Op>
+using as_op_t = typename as_op<Op>::type;
+
+template <typename Op, typename... Ops>
+inline constexpr std::size_t op_index = 0;
+
+template <typename Op, typename First, typename... Rest>
+inline constexpr std::size_t op_index<Op, First, Rest...> =
+    std::is_same_v<Op, First> ? 0 : 1 + op_index<Op, Rest...>;
+
+// Descriptor of T, a variable rather than a function-local static so that
+// its address is a constant expression
+template <typename Descriptor, typename T, typename... Ops>
+inline constexpr Descriptor descriptor_for =
+    Descriptor::template make<T, Ops...>();
+
 template <typename R, typename... Args>
 struct type_descriptor {
   using storage_t = storage<R, Args...>;
@@ -33,6 +223,72 @@ struct type_descriptor {
   void (*move)(storage_t*, storage_t*) noexcept;
   R (*invoke)(storage_t*, Args...);
   void (*destroy)(storage_t*) noexcept;
+  std::string_view name;
+  // Moves the target out into a one-shot C callback, leaves src empty
+  c_callback_pair<R, Args...> (*release)(storage_t*);
+  // Table of extra operations (ops_table<T, Ops...>), null if there are none
+  // or the function is empty
+  void const* ops;
+  // Overwrites the R at `out` with the result, null if R is not an object
+  // type that can be move-assigned
+  void (*invoke_into)(storage_t*, void* out, Args...);
+  // The target can be relocated by copying the buffer bytes: it lives on the
+  // heap or is small and trivially copyable
+  bool relocatable;
+  // type_tag of the target type, null if the function is empty
+  void const* type_id;
+
+  template <typename... Ops>
+  using ops_table_t = std::tuple<typename op_thunk<storage_t, Ops>::type...>;
+
+  template <typename T, typename... Ops>
+  static constexpr ops_table_t<Ops...> ops_table = {
+      op_thunk<storage_t, Ops>::template entry<T>...};
+
+  // C callback context is the storage itself
+  static R invoke_storage(void* ctx, Args... args) {
+    auto* storage = static_cast<storage_t*>(ctx);
+    return storage->desc->invoke(storage, std::forward<Args>(args)...);
+  }
+
+  // Context is either the bits of a small trivially copyable target or an
+  // owning pointer to the target, which is destroyed after the call
+  template <typename T>
+  static R invoke_once(void* ctx, Args... args) {
+    if constexpr (fits_small<T> && std::is_trivially_copyable_v<T>) {
+      container_t buffer;
+      std::memcpy(&buffer, &ctx, sizeof(T));
+      return invoke_target<R>(*std::launder(reinterpret_cast<T*>(&buffer)),
+                              std::forward<Args>(args)...);
+    } else {
+      std::unique_ptr<T> target(static_cast<T*>(ctx));
+      return invoke_target<R>(*target, std::forward<Args>(args)...);
+    }
+  }
+
+  // Prefers a target's own `invoke_into(R&, Args...)`, which may reuse the
+  // buffers of `out`, over assigning the result of a regular call
+  template <typename T>
+  static void invoke_into_target(storage_t* storage, void* out,
+                                 Args... args) {
+    T& target = *storage->template get<T>();
+    R& result = *static_cast<R*>(out);
+    if constexpr (has_invoke_into<void, T, R&, Args...>) {
+      target.invoke_into(result, std::forward<Args>(args)...);
+    } else {
+      result = target(std::forward<Args>(args)...);
+    }
+  }
+
+  template <typename T>
+  static constexpr auto get_invoke_into() noexcept
+      -> void (*)(storage_t*, void*, Args...) {
+    if constexpr (std::is_object_v<R> && std::is_move_assignable_v<R>) {
+      return &invoke_into_target<T>;
+    } else {
+      return nullptr;
+    }
+  }
 
   static type_descriptor<R, Args...> const*
   get_empty_func_descriptor() noexcept {
@@ -54,20 +310,39 @@ struct type_descriptor {
           throw bad_function_call{"empty function ivocation"};
         },
         /* destroy */
-        [](storage_t*) noexcept { /* noop */ }};
+        [](storage_t*) noexcept { /* noop */ },
+        /* name */
+        {},
+        /* release */
+        [](storage_t*) -> c_callback_pair<R, Args...> {
+          return {[](void*, Args...) -> R {
+                    throw bad_function_call{"empty function ivocation"};
+                  },
+                  nullptr};
+        },
+        /* ops */
+        nullptr,
+        /* invoke_into */
+        [](storage_t*, void*, Args...) {
+          throw bad_function_call{"empty function ivocation"};
+        },
+        /* relocatable */
+        true,
+        /* type_id */
+        nullptr};
 
     return &result;
   }
 
-  template <typename T>
-  static type_descriptor<R, Args...> const* get_descriptor() {
-    static constexpr type_descriptor<R, Args...> descriptor = {
+  template <typename T, typename... Ops>
+  static constexpr type_descriptor<R, Args...> make() {
+    return {
         /* copy */
         [](storage_t* dst, storage_t const* src) {
           // Pre: dst has empty descriptor
           assert(dst->desc == get_empty_func_descriptor());
           if constexpr (fits_small<T>) {
-            new (&dst->small) T(*src->template get<T>());
+            new (&dst->buffer) T(*src->template get<T>());
           } else {
             dst->set(new T(*src->template get<T>()));
           }
@@ -79,8 +354,8 @@ struct type_descriptor {
           // Post: src has empty descriptor
           assert(dst->desc == get_empty_func_descriptor());
           if constexpr (fits_small<T>) {
-            new (&dst->small) T(std::move(*src->template get<T>()));
-            src->desc->destroy(src);
+            new (&dst->buffer) T(std::move(*src->template get<T>()));
+            src->template get<T>()->~T();
           } else {
             dst->set((void*)src->template get<T>());
           }
@@ -90,7 +365,8 @@ struct type_descriptor {
         },
         /* invoke */
         [](storage_t* dst, Args... args) -> R {
-          return (*(dst->template get<T>()))(std::forward<Args>(args)...);
+          return invoke_target<R>(*(dst->template get<T>()),
+                                  std::forward<Args>(args)...);
         },
         /* destroy */
         [](storage_t* dst) noexcept {
@@ -99,71 +375,302 @@ struct type_descriptor {
           } else {
             delete dst->template get<T>();
           }
-        }};
+        },
+        /* name */
+        type_name<unwrapped_t<T>>(),
+        /* release */
+        [](storage_t* src) -> c_callback_pair<R, Args...> {
+          void* ctx = nullptr;
+          if constexpr (!fits_small<T>) {
+            ctx = src->template get<T>();
+          } else if constexpr (std::is_trivially_copyable_v<T>) {
+            std::memcpy(&ctx, src->template get<T>(), sizeof(T));
+          } else {
+            // The only case that allocates: the target cannot leave the
+            // buffer as plain bytes
+            ctx = new T(std::move(*src->template get<T>()));
+            src->template get<T>()->~T();
+          }
+          src->desc = get_empty_func_descriptor();
+          return {&invoke_once<T>, ctx};
+        },
+        /* ops */
+        sizeof...(Ops) == 0 ? nullptr : &ops_table<T, Ops...>,
+        /* invoke_into */
+        get_invoke_into<T>(),
+        /* relocatable */
+        !fits_small<T> || std::is_trivially_copyable_v<T>,
+        /* type_id */
+        &type_tag<unwrapped_t<T>>};
+  }
 
-    return &descriptor;
+  template <typename T, typename... Ops>
+  static constexpr type_descriptor<R, Args...> const* get_descriptor() {
+    return &descriptor_for<type_descriptor<R, Args...>, T, Ops...>;
   }
 
-  template <typename T>
-  static void init(storage_t& storage, T&& func) {
-    storage.desc = get_descriptor<T>();
+  // Constructs a T from `func` in empty storage. The descriptor is set last,
+  // so the storage stays empty if the construction throws.
+  template <typename T, typename... Ops, typename F>
+  static void init(storage_t& storage, F&& func) {
     if constexpr (fits_small<T>) {
-      new (&storage.small) T(std::forward<T>(func));
+      new (&storage.buffer) T(std::forward<F>(func));
     } else {
-      storage.set(new T(std::forward<T>(func)));
+      storage.set(new T(std::forward<F>(func)));
     }
+    storage.desc = get_descriptor<T, Ops...>();
   }
 };
 
-template <typename R, typename... Args>
-struct storage {
-
-  storage() : desc{type_descriptor<R, Args...>::get_empty_func_descriptor()} {}
+// Storage engine of function, inline_poly and any_value: a descriptor and a
+// buffer that holds small objects in place and a pointer to the others.
+// Derived provides fits_small<T>, which picks between the two, and
+// get_empty_descriptor(); Descriptor the copy, move and destroy thunks on
+// Derived and the relocatable flag. Derived destroys the object.
+template <typename Derived, typename Descriptor, typename Buffer>
+struct basic_storage {
+  // The buffer is zeroed, so that relocating an empty storage byte-wise
+  // copies defined bytes
+  basic_storage() noexcept
+      : desc{Derived::get_empty_descriptor()}, buffer{} {}
+
+  basic_storage(basic_storage const&) = delete;
+  basic_storage& operator=(basic_storage const&) = delete;
 
   template <typename T>
-  T* get() {
-    if constexpr (fits_small<T>) {
-      return reinterpret_cast<T*>(&small);
+  T* get() noexcept {
+    if constexpr (Derived::template fits_small<T>) {
+      return std::launder(reinterpret_cast<T*>(&buffer));
     } else {
-      return *reinterpret_cast<T**>(&small);
+      return *reinterpret_cast<T**>(&buffer);
     }
   }
 
   template <typename T>
-  T const* get() const {
-    if constexpr (fits_small<T>) {
-      return reinterpret_cast<T const*>(&small);
+  T const* get() const noexcept {
+    return const_cast<basic_storage*>(this)->template get<T>();
+  }
+
+  void set(void* t) noexcept {
+    new (&buffer)(void*)(t);
+  }
+
+  // Pre: empty. Post: other is empty
+  void move_from(Derived& other) noexcept {
+    assert(desc == Derived::get_empty_descriptor());
+    if (other.desc->relocatable) {
+      desc = other.desc;
+      buffer = other.buffer;
+      other.desc = Derived::get_empty_descriptor();
+    } else {
+      other.desc->move(self(), &other);
+    }
+  }
+
+  void reset() noexcept {
+    desc->destroy(self());
+    desc = Derived::get_empty_descriptor();
+  }
+
+  // Takes the object of `other` out before destroying the current one, which
+  // may own `other`. Relocatable objects are moved as bytes, others go
+  // through a temporary with two move thunk calls.
+  void move_assign(Derived& other) noexcept {
+    if (other.desc->relocatable) {
+      auto const* moved = other.desc;
+      Buffer bytes = other.buffer;
+      other.desc = Derived::get_empty_descriptor();
+      desc->destroy(self());
+      desc = moved;
+      buffer = bytes;
     } else {
-      return *reinterpret_cast<T* const*>(&small);
+      Derived tmp;
+      other.desc->move(&tmp, &other);
+      reset();
+      tmp.desc->move(self(), &tmp);
+    }
+  }
+
+  // Exchanges the buffers directly when both objects are relocatable, which
+  // covers all heap objects, and falls back to three moves
+  void swap(Derived& other) noexcept {
+    if (desc->relocatable && other.desc->relocatable) {
+      std::swap(desc, other.desc);
+      std::swap(buffer, other.buffer);
+      return;
     }
+    Derived tmp;
+    tmp.move_from(*self());
+    move_from(other);
+    other.move_from(tmp);
   }
 
-  void set(void* t) {
-    new (&small)(void*)(t);
+  Descriptor const* desc;
+  Buffer buffer;
+
+private:
+  Derived* self() noexcept {
+    return static_cast<Derived*>(this);
   }
+};
 
-  void swap(storage& other) {
-    storage tmp;
+template <typename R, typename... Args>
+struct storage
+    : basic_storage<storage<R, Args...>, type_descriptor<R, Args...>,
+                    container_t> {
+  template <typename T>
+  static constexpr bool fits_small = function_impl::fits_small<T>;
 
-    this->desc->move(&tmp, this);
-    other.desc->move(this, &other);
-    tmp.desc->move(&other, &tmp);
+  static type_descriptor<R, Args...> const* get_empty_descriptor() noexcept {
+    return type_descriptor<R, Args...>::get_empty_func_descriptor();
   }
 
   ~storage() {
-    desc->destroy(this);
+    this->desc->destroy(this);
+  }
+};
+
+// Perfect hash table from the descriptors of the candidate types of a visit
+// to their positions among the candidates. The multiplier of the hash is
+// searched when the table is built, so that no two descriptors share a slot:
+// a lookup is one multiplication, one shift and one load.
+class visit_table {
+public:
+  struct entry {
+    void const* desc{nullptr};
+    std::size_t index{0};
+  };
+
+  // Not inlined, so that the search stays out of every visit
+#if defined(__GNUC__)
+  __attribute__((noinline))
+#endif
+  visit_table(std::initializer_list<void const*> descs) {
+    for (bits = 1; (std::size_t{1} << bits) < 2 * descs.size(); ++bits) {
+    }
+    std::uint64_t candidate = 0x9E3779B97F4A7C15u;
+    for (std::size_t attempt = 1;; ++attempt) {
+      multiplier = candidate | 1;
+      if (fill(descs)) {
+        return;
+      }
+      candidate = candidate * 6364136223846793005u + 1442695040888963407u;
+      // Collisions get unlikely quickly as the table grows
+      if (attempt % 64 == 0) {
+        ++bits;
+      }
+    }
   }
 
-  type_descriptor<R, Args...> const* desc{nullptr};
-  container_t small;
+  entry const& find(void const* desc) const noexcept {
+    return entries[slot(desc)];
+  }
+
+private:
+  std::size_t slot(void const* desc) const noexcept {
+    auto address = static_cast<std::uint64_t>(
+        reinterpret_cast<std::uintptr_t>(desc));
+    return static_cast<std::size_t>((address * multiplier) >> (64 - bits));
+  }
+
+  // Places every descriptor at its slot, a repeated one keeps the position
+  // of its first occurrence. Fails on a collision.
+  bool fill(std::initializer_list<void const*> descs) {
+    entries = std::make_unique<entry[]>(std::size_t{1} << bits);
+    std::size_t index = 0;
+    for (void const* desc : descs) {
+      entry& e = entries[slot(desc)];
+      if (e.desc == nullptr) {
+        e = {desc, index};
+      } else if (e.desc != desc) {
+        return false;
+      }
+      ++index;
+    }
+    return true;
+  }
+
+  std::unique_ptr<entry[]> entries;
+  std::uint64_t multiplier{0};
+  unsigned bits{0};
+};
+
+// Calls `visitor` with the target of `storage` if its descriptor is the one
+// of a type among `Stored`, returns whether it did. The descriptor is looked
+// up once in a visit_table built on the first visit with these candidates,
+// and the visitor is called through the thunk at the position found there.
+template <typename Descriptor, typename OpList, typename... Stored>
+struct visit_dispatch;
+
+template <typename Descriptor, typename... Ops, typename... Stored>
+struct visit_dispatch<Descriptor, std::tuple<Ops...>, Stored...> {
+  using storage_t = typename Descriptor::storage_t;
+
+  template <typename Visitor>
+  static bool visit(storage_t* storage, Visitor& visitor) {
+    static constexpr void (*thunks[])(storage_t*, Visitor&) = {
+        &call<Stored, Visitor>...};
+    visit_table::entry const& e = table().find(storage->desc);
+    if (e.desc != storage->desc) {
+      return false;
+    }
+    thunks[e.index](storage, visitor);
+    return true;
+  }
+
+  static visit_table const& table() {
+    static visit_table const result{
+        Descriptor::template get_descriptor<Stored, Ops...>()...};
+    return result;
+  }
+
+  template <typename T, typename Visitor>
+  static void call(storage_t* storage, Visitor& visitor) {
+    visitor(static_cast<unwrapped_t<T>&>(*storage->template get<T>()));
+  }
+};
+
+// Never constructed, only terminates the chain of operator() overloads
+struct no_overload {};
+
+// Adds operator() for every call signature among Ops
+template <typename Derived, typename... Ops>
+struct overloads {
+  void operator()(no_overload) = delete;
+};
+
+template <typename Derived, typename Op, typename... Rest>
+struct overloads<Derived, Op, Rest...> : overloads<Derived, Rest...> {};
+
+template <typename Derived, typename R, typename... Args, typename... Rest>
+struct overloads<Derived, R(Args...), Rest...> : overloads<Derived, Rest...> {
+  using overloads<Derived, Rest...>::operator();
+
+  R operator()(Args... args) {
+    return static_cast<Derived&>(*this).template call<R(Args...)>(
+        std::forward<Args>(args)...);
+  }
 };
 } // namespace function_impl
 
-template <typename T>
+// `Ops` are extra operations (see function_impl::op_thunk) that every target
+// has to support. They are stored in the same descriptor as invoke and are
+// called with call<Op>(args...). A function type among `Ops` is one more call
+// signature: function<void(int), void(std::string_view)> holds a single
+// target that is invocable with both and picks the overload at the call site.
+template <typename T, typename... Ops>
 struct function;
 
-template <typename R, typename... Args>
-struct function<R(Args...)> {
+// Compile-time id of a callable type, see function::target_type(). Does not
+// need RTTI.
+template <typename F>
+constexpr void const* target_type_id() noexcept {
+  return &function_impl::type_tag<F>;
+}
+
+template <typename R, typename... Args, typename... Ops>
+struct function<R(Args...), Ops...>
+    : function_impl::overloads<function<R(Args...), Ops...>, Ops...> {
   function() = default;
 
   function(function const& other) : function() {
@@ -187,20 +694,37 @@ struct function<R(Args...)> {
     if (this == &other) {
       return *this;
     }
-    function tmp(std::move(other));
-    swap(tmp);
+    storage.move_assign(other.storage);
     return *this;
   }
 
   template <typename F>
   function(F f) {
-    desc_t::template init<F>(storage, std::move(f));
+    desc_t::template init<function_impl::stored_t<F, Ops...>,
+                          function_impl::as_op_t<Ops>...>(storage,
+                                                          std::move(f));
   }
 
+  // The result is returned as a prvalue all the way from the target, so it
+  // is constructed directly in the caller's return slot, even if R can be
+  // neither copied nor moved
   R apply(Args... args) {
     return storage.desc->invoke(&storage, std::forward<Args>(args)...);
   }
 
+  // Stores the result into an existing object instead of returning a new
+  // one. Targets that provide `invoke_into(R&, Args...)` can reuse the
+  // buffers `out` already owns, others are called and move-assigned.
+  template <typename Out = R,
+            typename = std::enable_if_t<std::is_same_v<Out, R> &&
+                                        std::is_object_v<Out>>>
+  void invoke_into(Out& out, Args... args) {
+    static_assert(std::is_move_assignable_v<R>,
+                  "invoke_into requires a move-assignable result type");
+    storage.desc->invoke_into(&storage, std::addressof(out),
+                              std::forward<Args>(args)...);
+  }
+
   template <typename F>
   F* target() noexcept {
     return const_cast<F*>(std::as_const(*this).template target<F>());
@@ -208,13 +732,56 @@ struct function<R(Args...)> {
 
   template <typename F>
   F const* target() const noexcept {
-    if (storage.desc == desc_t::template get_descriptor<F>()) {
-      return storage.template get<F>();
+    using stored_t = function_impl::stored_t<F, Ops...>;
+    if (storage.desc ==
+        desc_t::template get_descriptor<stored_t,
+                                        function_impl::as_op_t<Ops>...>()) {
+      return storage.template get<stored_t>();
     } else {
       return nullptr;
     }
   }
 
+  // `Op` is an operation or one of the extra call signatures
+  template <typename Op, typename... Ts>
+  decltype(auto) call(Ts&&... args) {
+    using op_t = function_impl::as_op_t<Op>;
+    static_assert((std::is_same_v<op_t, function_impl::as_op_t<Ops>> || ...),
+                  "Op is not an operation of this function");
+    if (storage.desc->ops == nullptr) {
+      throw bad_function_call{"empty function ivocation"};
+    }
+    auto const& table = *static_cast<typename desc_t::template ops_table_t<
+        function_impl::as_op_t<Ops>...> const*>(storage.desc->ops);
+    return std::get<
+        function_impl::op_index<op_t, function_impl::as_op_t<Ops>...>>(table)(
+        &storage, std::forward<Ts>(args)...);
+  }
+
+  // Calls `visitor` with the target if its type is one of Fs and returns
+  // whether it did. Dispatch is one table lookup and one indirect call,
+  // whatever the number of candidates.
+  template <typename... Fs, typename Visitor>
+  bool visit(Visitor&& visitor) {
+    static_assert(sizeof...(Fs) != 0, "visit needs at least one type");
+    return function_impl::visit_dispatch<
+        desc_t, std::tuple<function_impl::as_op_t<Ops>...>,
+        function_impl::stored_t<Fs, Ops...>...>::visit(&storage, visitor);
+  }
+
+  // Id of the stored callable type, equal to target_type_id<F>() for a
+  // target of type F and null for an empty function
+  void const* target_type() const noexcept {
+    return storage.desc->type_id;
+  }
+
+  // Name of the stored callable type, empty for an empty function
+  std::string_view target_name() const noexcept {
+    return storage.desc->name;
+  }
+
+  using function_impl::overloads<function, Ops...>::operator();
+
   R operator()(Args... args) {
     return apply(std::forward<Args>(args)...);
   }
@@ -223,6 +790,20 @@ struct function<R(Args...)> {
     return storage.desc != desc_t::get_empty_func_descriptor();
   }
 
+  // Non-owning C callback that invokes this function; valid as long as the
+  // function object is alive and is not moved from
+  c_callback_pair<R, Args...> c_callback() noexcept {
+    return {&desc_t::invoke_storage, &storage};
+  }
+
+  // Transfers the target into a C callback that must be called exactly once:
+  // the call destroys the target. Small trivially copyable targets travel
+  // inside `ctx` itself and heap targets hand over their allocation, so only
+  // small targets that are not trivially copyable are allocated.
+  c_callback_pair<R, Args...> release_c_callback() && {
+    return storage.desc->release(&storage);
+  }
+
   ~function() = default;
 
   void swap(function& other) noexcept {
@@ -235,3 +816,108 @@ private:
 
   function_impl::storage<R, Args...> storage;
 };
+
+// Non-owning reference to a callable, two pointers wide. The referenced
+// object has to outlive the view.
+template <typename T>
+struct function_view;
+
+template <typename R, typename... Args>
+struct function_view<R(Args...)> {
+  template <typename F,
+            typename = std::enable_if_t<
+                !std::is_same_v<std::remove_cv_t<F>, function_view>>>
+  function_view(F& f) noexcept
+      : callback{[](void* ctx, Args... args) -> R {
+                   return function_impl::invoke_target<R>(
+                       *static_cast<F*>(ctx), std::forward<Args>(args)...);
+                 },
+                 const_cast<void*>(static_cast<void const*>(&f))} {}
+
+  // Views of a function call through its descriptor, like c_callback()
+  function_view(function<R(Args...)>& f) noexcept
+      : callback{f.c_callback()} {}
+
+  R operator()(Args... args) const {
+    return callback(std::forward<Args>(args)...);
+  }
+
+  c_callback_pair<R, Args...> c_callback() const noexcept {
+    return callback;
+  }
+
+private:
+  c_callback_pair<R, Args...> callback;
+};
+
+namespace function_impl {
+// Calls F with itself as the first argument. The self argument has a
+// concrete type, so recursive calls do not go through a descriptor and may
+// be inlined. The declared return type lets lambdas call `self` without
+// spelling out their own return type.
+template <typename R, typename F>
+struct fixed_point {
+  template <typename... Ts>
+  R operator()(Ts&&... args) {
+    return f(*this, std::forward<Ts>(args)...);
+  }
+
+  F f;
+};
+} // namespace function_impl
+
+// Function whose target takes a reference to itself as its first argument,
+// so that recursion needs neither an erased call nor a capture of the
+// function object:
+//
+//   recursive_function<int(int)> fib = [](auto& self, int n) {
+//     return n < 2 ? n : self(n - 1) + self(n - 2);
+//   };
+template <typename T, typename... Ops>
+struct recursive_function;
+
+template <typename R, typename... Args, typename... Ops>
+struct recursive_function<R(Args...), Ops...> : function<R(Args...), Ops...> {
+  recursive_function() = default;
+
+  template <typename F, typename = std::enable_if_t<
+                            !std::is_same_v<F, recursive_function>>>
+  recursive_function(F f)
+      : function<R(Args...), Ops...>(
+            function_impl::fixed_point<R, F>{std::move(f)}) {}
+
+  template <typename F>
+  F* target() noexcept {
+    return const_cast<F*>(std::as_const(*this).template target<F>());
+  }
+
+  template <typename F>
+  F const* target() const noexcept {
+    auto const* fixed = function<R(Args...), Ops...>::template target<
+        function_impl::fixed_point<R, F>>();
+    return fixed != nullptr ? &fixed->f : nullptr;
+  }
+};
+
+// Signatures instantiated once in function.cpp. Define
+// FUNCTION_EXTERN_TEMPLATES (the function_lib target does) to skip emitting
+// their class members in every other translation unit. The member templates
+// on the target type (construction, get_descriptor) are still instantiated
+// wherever a target is stored, and optimizing compilers instantiate the
+// inline members anyway to inline them, so this barely saves build time,
+// see bench/build-bench.sh.
+#if defined(FUNCTION_EXTERN_TEMPLATES)
+#define FUNCTION_INSTANTIATE(...)                                              \
+  extern template struct function_impl::type_descriptor<__VA_ARGS__>;          \
+  extern template struct function_impl::storage<__VA_ARGS__>;
+FUNCTION_INSTANTIATE(void)
+FUNCTION_INSTANTIATE(void, int)
+FUNCTION_INSTANTIATE(bool)
+FUNCTION_INSTANTIATE(bool, int const&)
+#undef FUNCTION_INSTANTIATE
+
+extern template struct function<void()>;
+extern template struct function<void(int)>;
+extern template struct function<bool()>;
+extern template struct function<bool(int const&)>;
+#endif
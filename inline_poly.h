@@ -0,0 +1,156 @@
+#pragma once
+
+#include "erased_storage.h"
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+// Owning polymorphic value holding any type derived from `Base`. Objects of
+// up to `N` bytes live inline, larger ones or ones with throwing moves on the
+// heap. Copyable if the stored type is, copying one that is not throws
+// std::logic_error.
+template <typename Base, std::size_t N = 3 * sizeof(void*)>
+class inline_poly {
+  using storage_t = erased_impl::storage<N, alignof(std::max_align_t)>;
+
+  template <typename T>
+  static constexpr bool is_derived =
+      std::is_base_of_v<Base, T> && !std::is_same_v<T, inline_poly>;
+
+public:
+  inline_poly() noexcept = default;
+
+  template <typename Derived,
+            typename = std::enable_if_t<is_derived<std::decay_t<Derived>>>>
+  inline_poly(Derived&& value) {
+    emplace<std::decay_t<Derived>>(std::forward<Derived>(value));
+  }
+
+  inline_poly(inline_poly const& other) {
+    std::ptrdiff_t offset = other.base_offset();
+    storage.copy_from(other.storage);
+    rebase(offset);
+  }
+
+  inline_poly(inline_poly&& other) noexcept {
+    std::ptrdiff_t offset = other.base_offset();
+    storage.move_from(other.storage);
+    rebase(offset);
+    other.base = nullptr;
+  }
+
+  inline_poly& operator=(inline_poly const& other) {
+    if (this != &other) {
+      inline_poly tmp(other);
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  // The stored object may own `other`, so it is destroyed only after
+  // `other` was moved out
+  inline_poly& operator=(inline_poly&& other) noexcept {
+    if (this != &other) {
+      inline_poly tmp(std::move(other));
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  ~inline_poly() = default;
+
+  template <typename Derived, typename... Ts>
+  Derived& emplace(Ts&&... args) {
+    static_assert(is_derived<Derived>, "Derived must derive from Base");
+    reset();
+    Derived& result =
+        storage.template emplace<Derived>(std::forward<Ts>(args)...);
+    base = &result;
+    return result;
+  }
+
+  void reset() noexcept {
+    storage.reset();
+    base = nullptr;
+  }
+
+  // The Base subobject is found once when the object is stored or relocated,
+  // so access is a plain load
+  Base* get() noexcept {
+    return base;
+  }
+
+  Base const* get() const noexcept {
+    return base;
+  }
+
+  Base* operator->() noexcept {
+    return base;
+  }
+
+  Base const* operator->() const noexcept {
+    return base;
+  }
+
+  Base& operator*() noexcept {
+    return *base;
+  }
+
+  Base const& operator*() const noexcept {
+    return *base;
+  }
+
+  explicit operator bool() const noexcept {
+    return base != nullptr;
+  }
+
+  // Stored object if its dynamic type is exactly Derived
+  template <typename Derived>
+  Derived* target() noexcept {
+    return const_cast<Derived*>(
+        std::as_const(*this).template target<Derived>());
+  }
+
+  template <typename Derived>
+  Derived const* target() const noexcept {
+    if (storage.desc == storage_t::template get_descriptor<Derived>()) {
+      return storage.template get<Derived>();
+    } else {
+      return nullptr;
+    }
+  }
+
+  // Name of the stored type, empty if there is none
+  std::string_view type_name() const noexcept {
+    return storage.desc->name;
+  }
+
+  void swap(inline_poly& other) noexcept {
+    std::ptrdiff_t offset = base_offset();
+    std::ptrdiff_t other_offset = other.base_offset();
+    storage.swap(other.storage);
+    rebase(other_offset);
+    other.rebase(offset);
+  }
+
+private:
+  // Position of the Base subobject in the stored object
+  std::ptrdiff_t base_offset() const noexcept {
+    if (base == nullptr) {
+      return 0;
+    }
+    return reinterpret_cast<char const*>(base) -
+           static_cast<char const*>(storage.address());
+  }
+
+  void rebase(std::ptrdiff_t offset) noexcept {
+    void* object = storage.address();
+    base = object == nullptr ? nullptr
+                             : reinterpret_cast<Base*>(
+                                   static_cast<char*>(object) + offset);
+  }
+
+  storage_t storage;
+  Base* base{nullptr};
+};
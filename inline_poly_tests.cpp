@@ -0,0 +1,188 @@
+#include "alloc_counter.h"
+#include "inline_poly.h"
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+namespace {
+struct shape {
+  virtual ~shape() = default;
+  virtual int area() const = 0;
+};
+
+struct square : shape {
+  explicit square(int side) : side(side) {}
+
+  int area() const override {
+    return side * side;
+  }
+
+  int side;
+};
+
+struct polygon : shape {
+  int area() const override {
+    return points[0] + points[1];
+  }
+
+  int points[32]{};
+};
+
+struct named {
+  virtual ~named() = default;
+  std::string name{"named"};
+};
+
+// shape is not the first base, so its address differs from the object's
+struct named_rect : named, shape {
+  named_rect(int w, int h) : w(w), h(h) {}
+
+  int area() const override {
+    return w * h;
+  }
+
+  int w;
+  int h;
+};
+
+struct unique_square : shape {
+  explicit unique_square(int side) : side(std::make_unique<int>(side)) {}
+
+  int area() const override {
+    return *side * *side;
+  }
+
+  std::unique_ptr<int> side;
+};
+
+struct counted : shape {
+  counted() {
+    ++instances;
+  }
+
+  counted(counted const&) {
+    ++instances;
+  }
+
+  ~counted() override {
+    --instances;
+  }
+
+  int area() const override {
+    return 1;
+  }
+
+  static inline int instances = 0;
+};
+
+using shape_t = inline_poly<shape, 48>;
+
+// Owns another shape, too large to be stored inline itself
+struct frame : shape {
+  explicit frame(shape_t inner) : inner(std::move(inner)) {}
+
+  int area() const override {
+    return inner->area() + 1;
+  }
+
+  shape_t inner;
+};
+} // namespace
+
+TEST(inline_poly_test, empty) {
+  shape_t s;
+  EXPECT_FALSE(static_cast<bool>(s));
+  EXPECT_EQ(nullptr, s.get());
+  EXPECT_TRUE(s.type_name().empty());
+  shape_t copy = s;
+  EXPECT_FALSE(static_cast<bool>(copy));
+}
+
+TEST(inline_poly_test, inline_and_heap) {
+  alloc_counter::guard guard;
+  shape_t s = square(3);
+  EXPECT_EQ(9, s->area());
+  EXPECT_EQ(0, guard.allocations());
+
+  shape_t p = polygon();
+  EXPECT_EQ(0, p->area());
+  EXPECT_EQ(1, guard.allocations());
+  EXPECT_NE(nullptr, p.target<polygon>());
+  EXPECT_EQ(nullptr, p.target<square>());
+}
+
+TEST(inline_poly_test, base_offset) {
+  shape_t s = named_rect(2, 3);
+  ASSERT_NE(nullptr, s.target<named_rect>());
+  EXPECT_EQ(static_cast<shape*>(s.target<named_rect>()), s.get());
+  EXPECT_EQ(6, s->area());
+
+  shape_t copy = s;
+  EXPECT_EQ(static_cast<shape*>(copy.target<named_rect>()), copy.get());
+  EXPECT_EQ(6, copy->area());
+
+  shape_t moved = std::move(copy);
+  EXPECT_FALSE(static_cast<bool>(copy));
+  EXPECT_EQ(static_cast<shape*>(moved.target<named_rect>()), moved.get());
+  EXPECT_EQ("named", moved.target<named_rect>()->name);
+}
+
+TEST(inline_poly_test, swap) {
+  shape_t a = named_rect(2, 3);
+  shape_t b = polygon();
+  shape_t c;
+  a.swap(b);
+  EXPECT_EQ(0, a->area());
+  EXPECT_EQ(6, b->area());
+  EXPECT_EQ(static_cast<shape*>(b.target<named_rect>()), b.get());
+  b.swap(c);
+  EXPECT_FALSE(static_cast<bool>(b));
+  EXPECT_EQ(6, c->area());
+}
+
+TEST(inline_poly_test, assignment) {
+  shape_t a = square(2);
+  shape_t b = named_rect(2, 3);
+  a = b;
+  EXPECT_EQ(6, a->area());
+  b = square(4);
+  a = std::move(b);
+  EXPECT_EQ(16, a->area());
+  EXPECT_FALSE(static_cast<bool>(b));
+}
+
+TEST(inline_poly_test, move_assign_from_own_object) {
+  shape_t s = frame(shape_t(square(3)));
+  s = std::move(s.target<frame>()->inner);
+  EXPECT_EQ(9, s->area());
+  EXPECT_EQ(nullptr, s.target<frame>());
+
+  s = frame(shape_t(counted()));
+  s = std::move(s.target<frame>()->inner);
+  EXPECT_EQ(1, counted::instances);
+  s.reset();
+  EXPECT_EQ(0, counted::instances);
+}
+
+TEST(inline_poly_test, move_only) {
+  shape_t s = unique_square(5);
+  shape_t moved = std::move(s);
+  EXPECT_EQ(25, moved->area());
+  EXPECT_THROW(shape_t copy = moved, std::logic_error);
+}
+
+TEST(inline_poly_test, lifetime) {
+  {
+    shape_t a = counted();
+    shape_t b = a;
+    shape_t c = std::move(a);
+    EXPECT_EQ(2, counted::instances);
+    b.reset();
+    EXPECT_EQ(1, counted::instances);
+    c.emplace<square>(1);
+    EXPECT_EQ(0, counted::instances);
+    c.emplace<counted>();
+  }
+  EXPECT_EQ(0, counted::instances);
+}
@@ -0,0 +1,36 @@
+// Built against function_lib: the common signatures come from the explicit
+// instantiations in function.cpp instead of this translation unit
+#include "function.h"
+#include <gtest/gtest.h>
+
+#if !defined(FUNCTION_EXTERN_TEMPLATES)
+#error "library_tests has to be linked with function_lib"
+#endif
+
+TEST(library_test, common_signatures) {
+  int sum = 0;
+  function<void()> a = [&sum] { ++sum; };
+  function<void(int)> b = [&sum](int x) { sum += x; };
+  function<bool()> c = [&sum] { return sum > 10; };
+  function<bool(int const&)> d = [](int const& x) { return x % 2 == 0; };
+
+  function<void()> a2 = a;
+  a2();
+  a = std::move(a2);
+  a();
+  b(10);
+  EXPECT_EQ(12, sum);
+  EXPECT_TRUE(c());
+  EXPECT_TRUE(d(sum));
+}
+
+TEST(library_test, empty_and_swap) {
+  function<void(int)> x;
+  EXPECT_THROW(x(1), bad_function_call);
+  int last = 0;
+  function<void(int)> y = [&last](int v) { last = v; };
+  x.swap(y);
+  x(5);
+  EXPECT_EQ(5, last);
+  EXPECT_FALSE(static_cast<bool>(y));
+}
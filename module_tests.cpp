@@ -0,0 +1,17 @@
+// Uses function through `import function;`, exits with 0 on success. Built
+// by the module test, see ci-extra/check-module.cmake, or against the
+// function_module target with BUILD_MODULE.
+#include <new>
+#include <utility>
+import function;
+
+int main() {
+  int sum = 0;
+  function<void(int)> add = [&sum](int x) { sum += x; };
+  function<void(int)> copy = add;
+  copy(2);
+  function<void(int)> moved = std::move(add);
+  moved(3);
+  function<bool()> check = [&sum] { return sum == 5; };
+  return check() ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+#pragma once
+
+#include "function.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Fixed set of worker threads that run the chunks of one job at a time
+// together with the calling thread. Every worker takes part in every job,
+// even if there is no chunk left for it, so a job never overlaps the next.
+class emit_pool {
+public:
+  explicit emit_pool(std::size_t workers) {
+    threads.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i) {
+      threads.emplace_back([this] { serve(); });
+    }
+  }
+
+  // One worker per hardware thread besides the caller
+  emit_pool()
+      : emit_pool(std::max(std::thread::hardware_concurrency(), 1u) - 1) {}
+
+  emit_pool(emit_pool const&) = delete;
+  emit_pool& operator=(emit_pool const&) = delete;
+
+  ~emit_pool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopped = true;
+    }
+    wakeup.notify_all();
+    for (auto& t : threads) {
+      t.join();
+    }
+  }
+
+  std::size_t workers() const noexcept {
+    return threads.size();
+  }
+
+  // Calls `chunk(i)` for every i in [0, count) and returns once all calls
+  // have. After an exception no further chunks are started, the first one is
+  // rethrown.
+  void run(std::size_t count, function_view<void(std::size_t)> chunk) {
+    if (count == 0) {
+      return;
+    }
+    if (threads.empty() || count == 1) {
+      for (std::size_t i = 0; i < count; ++i) {
+        chunk(i);
+      }
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      job = &chunk;
+      chunks = count;
+      next.store(0, std::memory_order_relaxed);
+      busy = threads.size();
+      ++generation;
+    }
+    wakeup.notify_all();
+    work(chunk, count);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return busy == 0; });
+    if (error) {
+      std::rethrow_exception(std::exchange(error, nullptr));
+    }
+  }
+
+private:
+  void serve() {
+    std::uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+      wakeup.wait(lock, [&] { return stopped || generation != seen; });
+      if (stopped) {
+        return;
+      }
+      seen = generation;
+      function_view<void(std::size_t)> chunk = *job;
+      std::size_t count = chunks;
+      lock.unlock();
+      work(chunk, count);
+      lock.lock();
+      if (--busy == 0) {
+        idle.notify_one();
+      }
+    }
+  }
+
+  void work(function_view<void(std::size_t)> chunk,
+            std::size_t count) noexcept {
+    for (std::size_t i = next.fetch_add(1, std::memory_order_relaxed);
+         i < count; i = next.fetch_add(1, std::memory_order_relaxed)) {
+      try {
+        chunk(i);
+      } catch (...) {
+        next.store(count, std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+      }
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  std::condition_variable idle;
+  bool stopped{false};
+  // Current job, published under the mutex with a new generation. The view
+  // lives in the frame of run(), which outlasts the job.
+  std::uint64_t generation{0};
+  function_view<void(std::size_t)> const* job{nullptr};
+  std::size_t chunks{0};
+  std::size_t busy{0};
+  std::exception_ptr error;
+  std::atomic<std::size_t> next{0};
+
+  std::vector<std::thread> threads;
+};
+
+// Subscribers of an event kept in one contiguous array, grouped by stage.
+// Emitting calls the stages in increasing order and each stage's
+// subscribers in connection order; parallel_emit calls the subscribers of a
+// stage concurrently and finishes a stage before starting the next one, so
+// stages are the ordering constraints between subscribers.
+template <typename Event>
+class subscriber_list {
+public:
+  using subscriber_t = function<void(Event const&)>;
+
+  // Subscribers per cache line, chunks are made of whole lines so that no
+  // two threads call subscribers stored in the same line
+  static constexpr std::size_t line = 64;
+  static constexpr std::size_t per_line =
+      line % sizeof(subscriber_t) == 0 ? line / sizeof(subscriber_t) : 1;
+
+  void connect(subscriber_t subscriber, std::size_t stage = 0) {
+    if (stage >= stage_ends.size()) {
+      stage_ends.resize(stage + 1, subscribers.size());
+    }
+    subscribers.insert(subscribers.begin() + stage_ends[stage],
+                       std::move(subscriber));
+    for (std::size_t s = stage; s < stage_ends.size(); ++s) {
+      ++stage_ends[s];
+    }
+  }
+
+  std::size_t size() const noexcept {
+    return subscribers.size();
+  }
+
+  void emit(Event const& event) {
+    for (auto& s : subscribers) {
+      s(event);
+    }
+  }
+
+  // Splits each stage into chunks of `grain` subscribers, rounded up to
+  // whole cache lines, and runs them on `pool`. A grain of 0 picks about
+  // four chunks per thread. Returns after every subscriber was called, an
+  // exception from one of them is rethrown after the stage finished.
+  void parallel_emit(Event const& event, emit_pool& pool,
+                     std::size_t grain = 0) {
+    std::size_t begin = 0;
+    for (std::size_t end : stage_ends) {
+      emit_stage(event, pool, grain, begin, end);
+      begin = end;
+    }
+  }
+
+private:
+  void emit_stage(Event const& event, emit_pool& pool, std::size_t grain,
+                  std::size_t begin, std::size_t end) {
+    if (begin == end) {
+      return;
+    }
+    if (grain == 0) {
+      grain = (end - begin) / (4 * (pool.workers() + 1));
+    }
+    grain = std::max<std::size_t>((grain + per_line - 1) / per_line, 1) *
+            per_line;
+    // Chunks start at cache line boundaries, `lead` is the number of
+    // subscribers in the line of `begin` that come before it
+    auto address = reinterpret_cast<std::uintptr_t>(&subscribers[begin]);
+    std::size_t lead = (address % line) / sizeof(subscriber_t) % per_line;
+    std::size_t count = (end - begin + lead + grain - 1) / grain;
+    subscriber_t* data = subscribers.data();
+    auto chunk = [&](std::size_t i) {
+      std::size_t first = i == 0 ? begin : begin + i * grain - lead;
+      std::size_t last = std::min(end, begin + (i + 1) * grain - lead);
+      for (std::size_t j = first; j < last; ++j) {
+        data[j](event);
+      }
+    };
+    pool.run(count, chunk);
+  }
+
+  std::vector<subscriber_t> subscribers;
+  // One past the last subscriber of every stage
+  std::vector<std::size_t> stage_ends;
+};
@@ -0,0 +1,90 @@
+#include "parallel_emit.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST(parallel_emit_test, calls_every_subscriber_once) {
+  constexpr std::size_t n = 10'000;
+  emit_pool pool(3);
+  subscriber_list<int> list;
+  std::vector<int> hits(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    list.connect([&hits, i](int const& x) { hits[i] += x; });
+  }
+  for (std::size_t grain : {std::size_t{0}, std::size_t{1}, std::size_t{7},
+                            std::size_t{100}, 2 * n}) {
+    list.parallel_emit(1, pool, grain);
+  }
+  list.emit(1);
+  for (std::size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(6, hits[i]) << i;
+  }
+}
+
+TEST(parallel_emit_test, stages_run_in_order) {
+  emit_pool pool(3);
+  subscriber_list<int> list;
+  std::atomic<int> first{0};
+  std::atomic<int> early{0};
+  for (int i = 0; i < 500; ++i) {
+    list.connect(
+        [&](int const&) {
+          if (first.load() != 500) {
+            ++early;
+          }
+        },
+        1);
+    list.connect([&](int const&) { ++first; });
+  }
+  list.parallel_emit(0, pool, 1);
+  EXPECT_EQ(500, first.load());
+  EXPECT_EQ(0, early.load());
+}
+
+TEST(parallel_emit_test, serial_emit_order) {
+  subscriber_list<int> list;
+  std::vector<int> log;
+  list.connect([&](int const&) { log.push_back(2); }, 2);
+  list.connect([&](int const&) { log.push_back(0); });
+  list.connect([&](int const&) { log.push_back(1); }, 1);
+  list.connect([&](int const&) { log.push_back(3); }, 2);
+  EXPECT_EQ(4u, list.size());
+  list.emit(0);
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3}), log);
+}
+
+TEST(parallel_emit_test, exception_is_rethrown) {
+  emit_pool pool(2);
+  subscriber_list<int> list;
+  std::atomic<int> calls{0};
+  for (int i = 0; i < 100; ++i) {
+    list.connect([&, i](int const&) {
+      ++calls;
+      if (i == 42) {
+        throw std::runtime_error("subscriber");
+      }
+    });
+  }
+  EXPECT_THROW(list.parallel_emit(0, pool, 1), std::runtime_error);
+  EXPECT_LE(calls.load(), 100);
+
+  // The pool is usable afterwards
+  std::atomic<int> chunks{0};
+  auto count = [&](std::size_t) { ++chunks; };
+  pool.run(10, count);
+  EXPECT_EQ(10, chunks.load());
+}
+
+TEST(parallel_emit_test, pool_without_workers) {
+  emit_pool pool(0);
+  EXPECT_EQ(0u, pool.workers());
+  subscriber_list<int> list;
+  int sum = 0;
+  for (int i = 0; i < 10; ++i) {
+    list.connect([&sum](int const& x) { sum += x; });
+  }
+  list.parallel_emit(2, pool);
+  EXPECT_EQ(20, sum);
+}
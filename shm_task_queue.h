@@ -0,0 +1,341 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace shm_task_impl {
+
+using thunk_t = void (*)(void const* payload);
+
+// Table of task thunks. Indices are handed out during static
+// initialization, so they are the same in every process forked from, or
+// started from, the same binary.
+class registry {
+public:
+  static registry& instance() {
+    static registry result;
+    return result;
+  }
+
+  std::uint32_t add(thunk_t thunk) {
+    thunks.push_back(thunk);
+    return static_cast<std::uint32_t>(thunks.size() - 1);
+  }
+
+  thunk_t get(std::uint32_t index) const noexcept {
+    return index < thunks.size() ? thunks[index] : nullptr;
+  }
+
+private:
+  std::vector<thunk_t> thunks;
+};
+
+template <typename F>
+void run(void const* payload) {
+  alignas(F) unsigned char buffer[sizeof(F)];
+  std::memcpy(buffer, payload, sizeof(F));
+  (*std::launder(reinterpret_cast<F*>(buffer)))();
+}
+
+template <typename F>
+inline std::uint32_t const task_index = registry::instance().add(&run<F>);
+
+// Task index of a cell whose producer died before publishing it
+inline constexpr std::uint32_t tombstone = UINT32_MAX;
+
+// A process that has exited but has not been reaped yet still counts as
+// alive
+inline bool alive(pid_t pid) noexcept {
+  return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+template <std::size_t PayloadSize>
+struct alignas(64) cell {
+  std::atomic<std::uint64_t> sequence;
+  // Process between claiming the cell and publishing or releasing it, 0 if
+  // none. Set before the queue position is advanced, so that a claim whose
+  // owner died can be told apart from one in progress.
+  std::atomic<pid_t> owner;
+  std::uint32_t task;
+  alignas(std::max_align_t) unsigned char payload[PayloadSize];
+};
+
+// Bounded MPMC ring after Dmitry Vyukov's design, placed in memory shared
+// by several processes. Every step that a crashed process could leave half
+// done is recoverable by the others:
+//
+// - a producer that died after claiming a cell: consumers find the cell
+//   unpublished with a dead owner and publish a tombstone in its place;
+// - a consumer that died while copying a task out: producers wrapping
+//   around find the cell unreleased with a dead owner and release it, the
+//   task is lost;
+// - a process that died before advancing the queue position: the next one
+//   to claim the cell resets the stale owner.
+template <std::size_t PayloadSize>
+class ring {
+public:
+  using cell_t = cell<PayloadSize>;
+
+  static_assert(std::atomic<std::uint64_t>::is_always_lock_free &&
+                    std::atomic<pid_t>::is_always_lock_free,
+                "shared memory atomics have to be lock-free");
+
+  static std::size_t bytes(std::size_t capacity) noexcept {
+    return sizeof(ring) + capacity * sizeof(cell_t);
+  }
+
+  // Pre: capacity is a power of two, `memory` is suitably aligned and at
+  // least bytes(capacity) large
+  static ring* create(void* memory, std::size_t capacity) noexcept {
+    ring* result = new (memory) ring(capacity);
+    for (std::size_t i = 0; i < capacity; ++i) {
+      cell_t* c = new (&result->cells()[i]) cell_t;
+      c->sequence.store(i, std::memory_order_relaxed);
+      c->owner.store(0, std::memory_order_relaxed);
+    }
+    return result;
+  }
+
+  std::size_t capacity() const noexcept {
+    return mask + 1;
+  }
+
+  // Claims the next cell for writing, returns false if the queue is full
+  bool claim_push(std::uint64_t& pos) noexcept {
+    pid_t self = getpid();
+    pos = enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+      cell_t& c = at(pos);
+      std::uint64_t seq = c.sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::int64_t>(seq - pos);
+      if (diff == 0) {
+        if (claim(c, self, enqueue_pos, pos)) {
+          return true;
+        }
+      } else if (diff < 0) {
+        if (!recover_unreleased(c, pos)) {
+          return false;
+        }
+      } else {
+        pos = enqueue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void publish(std::uint64_t pos, std::uint32_t task, void const* payload,
+               std::size_t size) noexcept {
+    cell_t& c = at(pos);
+    c.task = task;
+    std::memcpy(c.payload, payload, size);
+    c.sequence.store(pos + 1, std::memory_order_release);
+    c.owner.store(0, std::memory_order_release);
+  }
+
+  // Claims the next published cell for reading, returns false if the queue
+  // is empty or the next cell is still being written
+  bool claim_pop(std::uint64_t& pos) noexcept {
+    pid_t self = getpid();
+    pos = dequeue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+      cell_t& c = at(pos);
+      std::uint64_t seq = c.sequence.load(std::memory_order_acquire);
+      auto diff = static_cast<std::int64_t>(seq - (pos + 1));
+      if (diff == 0) {
+        if (claim(c, self, dequeue_pos, pos)) {
+          return true;
+        }
+      } else if (diff < 0) {
+        if (!recover_unpublished(c, pos)) {
+          return false;
+        }
+      } else {
+        pos = dequeue_pos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Copies the task out and hands the cell back to producers
+  std::uint32_t release(std::uint64_t pos, void* payload) noexcept {
+    cell_t& c = at(pos);
+    std::uint32_t task = c.task;
+    std::memcpy(payload, c.payload, PayloadSize);
+    c.sequence.store(pos + mask + 1, std::memory_order_release);
+    c.owner.store(0, std::memory_order_release);
+    return task;
+  }
+
+private:
+  explicit ring(std::size_t capacity) noexcept : mask(capacity - 1) {}
+
+  cell_t* cells() noexcept {
+    return reinterpret_cast<cell_t*>(this + 1);
+  }
+
+  cell_t& at(std::uint64_t pos) noexcept {
+    return cells()[pos & mask];
+  }
+
+  // Owns the cell at `pos`, then advances `position` past it. On failure
+  // `pos` is the position to retry at.
+  static bool claim(cell_t& c, pid_t self,
+                    std::atomic<std::uint64_t>& position,
+                    std::uint64_t& pos) noexcept {
+    pid_t expected = 0;
+    if (!c.owner.compare_exchange_strong(expected, self,
+                                         std::memory_order_acquire)) {
+      // Died before advancing the position: nobody else will clean up
+      if (!alive(expected) &&
+          position.load(std::memory_order_relaxed) == pos) {
+        c.owner.compare_exchange_strong(expected, 0,
+                                        std::memory_order_relaxed);
+      }
+      pos = position.load(std::memory_order_relaxed);
+      return false;
+    }
+    if (position.compare_exchange_strong(pos, pos + 1,
+                                         std::memory_order_relaxed)) {
+      return true;
+    }
+    c.owner.store(0, std::memory_order_release);
+    return false;
+  }
+
+  // The cell still holds the task of the previous lap: either the queue is
+  // full or the consumer that claimed the task died
+  bool recover_unreleased(cell_t& c, std::uint64_t pos) noexcept {
+    std::uint64_t previous = pos - (mask + 1);
+    if (dequeue_pos.load(std::memory_order_relaxed) <= previous) {
+      return false;
+    }
+    pid_t owner = c.owner.load(std::memory_order_acquire);
+    if (owner == 0) {
+      // The owner cleared the claim after completing it
+      return true;
+    }
+    if (alive(owner) ||
+        !c.owner.compare_exchange_strong(owner, getpid(),
+                                         std::memory_order_acquire)) {
+      return false;
+    }
+    if (c.sequence.load(std::memory_order_relaxed) == previous + 1) {
+      c.sequence.store(pos, std::memory_order_release);
+    }
+    c.owner.store(0, std::memory_order_release);
+    return true;
+  }
+
+  // The cell is not published: either the queue is empty or the producer
+  // that claimed the cell died
+  bool recover_unpublished(cell_t& c, std::uint64_t pos) noexcept {
+    if (enqueue_pos.load(std::memory_order_relaxed) <= pos) {
+      return false;
+    }
+    pid_t owner = c.owner.load(std::memory_order_acquire);
+    if (owner == 0) {
+      // The owner cleared the claim after completing it
+      return true;
+    }
+    if (alive(owner) ||
+        !c.owner.compare_exchange_strong(owner, getpid(),
+                                         std::memory_order_acquire)) {
+      return false;
+    }
+    if (c.sequence.load(std::memory_order_relaxed) == pos) {
+      c.task = tombstone;
+      c.sequence.store(pos + 1, std::memory_order_release);
+    }
+    c.owner.store(0, std::memory_order_release);
+    return true;
+  }
+
+  alignas(64) std::atomic<std::uint64_t> enqueue_pos{0};
+  alignas(64) std::atomic<std::uint64_t> dequeue_pos{0};
+  alignas(64) std::uint64_t const mask;
+};
+} // namespace shm_task_impl
+
+// Task queue shared by a process and the workers it forks afterwards.
+// Tasks are trivially copyable callables of up to PayloadSize bytes: they
+// travel as their bytes plus an index into a registry of thunks that is
+// identical in all processes, so nothing is serialized. Processes that
+// crash in the middle of a push or pop do not block the others, see
+// shm_task_impl::ring.
+template <std::size_t PayloadSize = 48>
+class shm_task_queue {
+  using ring_t = shm_task_impl::ring<PayloadSize>;
+
+public:
+  // The capacity is rounded up to a power of two
+  explicit shm_task_queue(std::size_t capacity) {
+    std::size_t rounded = 1;
+    while (rounded < capacity) {
+      rounded *= 2;
+    }
+    size = ring_t::bytes(rounded);
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+      throw std::system_error(errno, std::generic_category(), "mmap");
+    }
+    queue = ring_t::create(memory, rounded);
+  }
+
+  shm_task_queue(shm_task_queue const&) = delete;
+  shm_task_queue& operator=(shm_task_queue const&) = delete;
+
+  ~shm_task_queue() {
+    munmap(queue, size);
+  }
+
+  std::size_t capacity() const noexcept {
+    return queue->capacity();
+  }
+
+  // Returns false if the queue is full
+  template <typename F>
+  bool try_push(F const& task) noexcept {
+    static_assert(std::is_trivially_copyable_v<F>,
+                  "tasks are copied between processes as bytes");
+    static_assert(sizeof(F) <= PayloadSize, "task does not fit the payload");
+    static_assert(alignof(F) <= alignof(std::max_align_t));
+    std::uint64_t pos;
+    if (!queue->claim_push(pos)) {
+      return false;
+    }
+    queue->publish(pos, shm_task_impl::task_index<F>, &task, sizeof(F));
+    return true;
+  }
+
+  // Runs the next task, returns false if there is none. Tombstones of
+  // crashed producers are skipped.
+  bool try_run_one() {
+    alignas(std::max_align_t) unsigned char payload[PayloadSize];
+    for (;;) {
+      std::uint64_t pos;
+      if (!queue->claim_pop(pos)) {
+        return false;
+      }
+      std::uint32_t task = queue->release(pos, payload);
+      if (auto thunk = shm_task_impl::registry::instance().get(task)) {
+        thunk(payload);
+        return true;
+      }
+    }
+  }
+
+private:
+  std::size_t size;
+  ring_t* queue;
+};
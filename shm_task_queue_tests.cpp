@@ -0,0 +1,193 @@
+#include "shm_task_queue.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+// Memory shared with the processes forked by a test
+template <typename T>
+struct shared {
+  shared() {
+    void* memory = mmap(nullptr, sizeof(T), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    value = new (memory) T();
+  }
+
+  ~shared() {
+    value->~T();
+    munmap(value, sizeof(T));
+  }
+
+  T* value;
+};
+
+struct add {
+  void operator()() const {
+    sum->fetch_add(n, std::memory_order_relaxed);
+  }
+
+  std::atomic<std::uint64_t>* sum;
+  std::uint64_t n;
+};
+
+using ring_t = shm_task_impl::ring<8>;
+
+struct shared_ring {
+  explicit shared_ring(std::size_t capacity)
+      : size(ring_t::bytes(capacity)),
+        memory(mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS, -1, 0)),
+        ring(ring_t::create(memory, capacity)) {}
+
+  ~shared_ring() {
+    munmap(memory, size);
+  }
+
+  void push(std::uint32_t task) {
+    std::uint64_t pos;
+    ASSERT_TRUE(ring->claim_push(pos));
+    ring->publish(pos, task, &task, sizeof(task));
+  }
+
+  std::uint32_t pop() {
+    std::uint64_t pos;
+    if (!ring->claim_pop(pos)) {
+      return 0;
+    }
+    unsigned char payload[8];
+    return ring->release(pos, payload);
+  }
+
+  std::size_t size;
+  void* memory;
+  ring_t* ring;
+};
+
+// Runs `f` in a child process that exits without cleaning up
+template <typename F>
+void in_child(F f) {
+  pid_t pid = fork();
+  ASSERT_NE(-1, pid);
+  if (pid == 0) {
+    f();
+    _exit(0);
+  }
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+}
+} // namespace
+
+TEST(shm_task_queue_test, runs_in_order) {
+  shm_task_queue<> queue(4);
+  std::vector<int> order;
+  auto* out = &order;
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(queue.try_push([out, i] { out->push_back(i); }));
+  }
+  while (queue.try_run_one()) {
+  }
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), order);
+}
+
+TEST(shm_task_queue_test, full_and_empty) {
+  shm_task_queue<> queue(3);
+  EXPECT_EQ(4u, queue.capacity());
+  EXPECT_FALSE(queue.try_run_one());
+  int runs = 0;
+  auto* p = &runs;
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.try_push([p] { ++*p; }));
+  }
+  EXPECT_FALSE(queue.try_push([p] { ++*p; }));
+  EXPECT_TRUE(queue.try_run_one());
+  EXPECT_TRUE(queue.try_push([p] { ++*p; }));
+  while (queue.try_run_one()) {
+  }
+  EXPECT_EQ(5, runs);
+}
+
+TEST(shm_task_queue_test, forked_workers) {
+  constexpr int workers = 3;
+  constexpr std::uint64_t tasks = 20'000;
+  shm_task_queue<> queue(64);
+  shared<std::atomic<std::uint64_t>> sum;
+  shared<std::atomic<bool>> done;
+
+  std::vector<pid_t> pids;
+  for (int i = 0; i < workers; ++i) {
+    pid_t pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+      for (;;) {
+        bool finished = done.value->load(std::memory_order_acquire);
+        if (!queue.try_run_one()) {
+          if (finished) {
+            _exit(0);
+          }
+          sched_yield();
+        }
+      }
+    }
+    pids.push_back(pid);
+  }
+
+  for (std::uint64_t n = 1; n <= tasks; ++n) {
+    while (!queue.try_push(add{sum.value, n})) {
+      sched_yield();
+    }
+  }
+  done.value->store(true, std::memory_order_release);
+  for (pid_t pid : pids) {
+    int status;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+  EXPECT_EQ(tasks * (tasks + 1) / 2, sum.value->load());
+}
+
+TEST(shm_task_queue_test, crashed_producer) {
+  shared_ring r(4);
+  r.push(1);
+  in_child([&] {
+    std::uint64_t pos;
+    r.ring->claim_push(pos);
+  });
+  r.push(2);
+
+  EXPECT_EQ(1u, r.pop());
+  EXPECT_EQ(shm_task_impl::tombstone, r.pop());
+  EXPECT_EQ(2u, r.pop());
+  EXPECT_EQ(0u, r.pop());
+}
+
+TEST(shm_task_queue_test, crashed_consumer) {
+  shared_ring r(2);
+  r.push(1);
+  r.push(2);
+  in_child([&] {
+    std::uint64_t pos;
+    r.ring->claim_pop(pos);
+  });
+
+  // Task 1 is lost along with the consumer, its cell is reused
+  r.push(3);
+  EXPECT_EQ(2u, r.pop());
+  EXPECT_EQ(3u, r.pop());
+  EXPECT_EQ(0u, r.pop());
+}
+
+TEST(shm_task_queue_test, live_claim_is_not_recovered) {
+  shared_ring r(4);
+  std::uint64_t pos;
+  ASSERT_TRUE(r.ring->claim_push(pos));
+  EXPECT_EQ(0u, r.pop());
+  r.ring->publish(pos, 5, &pos, 0);
+  EXPECT_EQ(5u, r.pop());
+}
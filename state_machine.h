@@ -0,0 +1,171 @@
+#pragma once
+
+#include "function.h"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+// Dense (state x event) next-state table of a state_machine. `State` and
+// `Event` are enums whose last enumerator is `count`, which as a state also
+// stands for "no transition" and "no parent". All members are constexpr, so
+// tables are normally built at compile time:
+//
+//   constexpr auto table = transition_table<state, event>()
+//                              .on(state::idle, event::dial, state::dialing)
+//                              .parent(state::talking, state::connected);
+template <typename State, typename Event>
+class transition_table {
+public:
+  static constexpr std::size_t n_states =
+      static_cast<std::size_t>(State::count);
+  static constexpr std::size_t n_events =
+      static_cast<std::size_t>(Event::count);
+
+  struct cell {
+    State next;
+    // Cell whose guard and action apply, an ancestor's cell if the
+    // transition is inherited
+    std::uint32_t owner;
+  };
+
+  constexpr transition_table() noexcept : cells(), parents() {
+    for (std::size_t i = 0; i < cells.size(); ++i) {
+      cells[i] = {State::count, static_cast<std::uint32_t>(i)};
+    }
+    for (auto& p : parents) {
+      p = State::count;
+    }
+  }
+
+  constexpr transition_table on(State from, Event event,
+                                State to) const noexcept {
+    transition_table result = *this;
+    std::size_t i = index(from, event);
+    result.cells[i] = {to, static_cast<std::uint32_t>(i)};
+    return result;
+  }
+
+  // Events that `child` has no transition for are handled as in `parent`
+  constexpr transition_table parent(State child,
+                                    State parent) const noexcept {
+    transition_table result = *this;
+    result.parents[static_cast<std::size_t>(child)] = parent;
+    return result;
+  }
+
+  // Copies inherited transitions into the descendants, so that a lookup is
+  // a single index computation whatever the depth of the hierarchy
+  constexpr transition_table resolve() const noexcept {
+    transition_table result = *this;
+    for (std::size_t s = 0; s < n_states; ++s) {
+      for (std::size_t e = 0; e < n_events; ++e) {
+        cell& c = result.cells[s * n_events + e];
+        for (State p = parents[s];
+             c.next == State::count && p != State::count;
+             p = parents[static_cast<std::size_t>(p)]) {
+          c = cells[static_cast<std::size_t>(p) * n_events + e];
+        }
+      }
+    }
+    return result;
+  }
+
+  constexpr cell const& at(State from, Event event) const noexcept {
+    return cells[index(from, event)];
+  }
+
+  constexpr State next(State from, Event event) const noexcept {
+    return at(from, event).next;
+  }
+
+  // True if `state` is `ancestor` or one of its descendants
+  constexpr bool within(State state, State ancestor) const noexcept {
+    for (State s = state; s != State::count;
+         s = parents[static_cast<std::size_t>(s)]) {
+      if (s == ancestor) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static constexpr std::size_t index(State from, Event event) noexcept {
+    return static_cast<std::size_t>(from) * n_events +
+           static_cast<std::size_t>(event);
+  }
+
+private:
+  std::array<cell, n_states * n_events> cells;
+  std::array<State, n_states> parents;
+};
+
+// Table-driven state machine: the next state comes from a resolved
+// transition_table and every transition may have a guard and an action,
+// both called with the arguments of dispatch. Dispatching an event is an
+// index computation plus the action call.
+template <typename State, typename Event, typename... Args>
+class state_machine {
+public:
+  using table_t = transition_table<State, Event>;
+  using guard_t = function<bool(Args...)>;
+  using action_t = function<void(Args...)>;
+
+  state_machine(table_t const& table, State initial)
+      : table(table.resolve()), current(initial) {}
+
+  // Both apply to the transition declared for (from, event) and are
+  // inherited by the descendants of `from` along with it
+  void on_transition(State from, Event event, action_t action) {
+    assert(is_declared(from, event));
+    handlers[table_t::index(from, event)].action = std::move(action);
+  }
+
+  void guard(State from, Event event, guard_t guard) {
+    assert(is_declared(from, event));
+    handlers[table_t::index(from, event)].guard = std::move(guard);
+  }
+
+  // Returns false if the current state has no transition for `event` or its
+  // guard rejected it. The state changes after the action returns.
+  bool dispatch(Event event, Args... args) {
+    auto const& c = table.at(current, event);
+    if (c.next == State::count) {
+      return false;
+    }
+    transition& t = handlers[c.owner];
+    if (t.guard && !t.guard(args...)) {
+      return false;
+    }
+    if (t.action) {
+      t.action(args...);
+    }
+    current = c.next;
+    return true;
+  }
+
+  State state() const noexcept {
+    return current;
+  }
+
+  // True if the current state is `s` or one of its descendants
+  bool in(State s) const noexcept {
+    return table.within(current, s);
+  }
+
+private:
+  struct transition {
+    guard_t guard;
+    action_t action;
+  };
+
+  bool is_declared(State from, Event event) const noexcept {
+    return table.at(from, event).owner == table_t::index(from, event) &&
+           table.next(from, event) != State::count;
+  }
+
+  table_t table;
+  std::array<transition, table_t::n_states * table_t::n_events> handlers;
+  State current;
+};
@@ -0,0 +1,85 @@
+#include "state_machine.h"
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+enum class state { idle, dialing, connected, talking, on_hold, count };
+enum class event { dial, answer, hold, resume, hang_up, count };
+
+// talking and on_hold are substates of connected and inherit hang_up
+constexpr auto phone =
+    transition_table<state, event>()
+        .on(state::idle, event::dial, state::dialing)
+        .on(state::dialing, event::answer, state::talking)
+        .on(state::dialing, event::hang_up, state::idle)
+        .on(state::connected, event::hang_up, state::idle)
+        .on(state::talking, event::hold, state::on_hold)
+        .on(state::on_hold, event::resume, state::talking)
+        .parent(state::talking, state::connected)
+        .parent(state::on_hold, state::connected);
+
+static_assert(phone.next(state::idle, event::dial) == state::dialing);
+static_assert(phone.next(state::idle, event::answer) == state::count);
+static_assert(phone.next(state::talking, event::hang_up) == state::count);
+static_assert(phone.resolve().next(state::talking, event::hang_up) ==
+              state::idle);
+static_assert(phone.within(state::on_hold, state::connected));
+static_assert(!phone.within(state::dialing, state::connected));
+} // namespace
+
+TEST(state_machine_test, transitions) {
+  state_machine<state, event> sm(phone, state::idle);
+  EXPECT_FALSE(sm.dispatch(event::answer));
+  EXPECT_EQ(state::idle, sm.state());
+  EXPECT_TRUE(sm.dispatch(event::dial));
+  EXPECT_TRUE(sm.dispatch(event::answer));
+  EXPECT_EQ(state::talking, sm.state());
+  EXPECT_TRUE(sm.dispatch(event::hold));
+  EXPECT_EQ(state::on_hold, sm.state());
+}
+
+TEST(state_machine_test, hierarchical) {
+  state_machine<state, event> sm(phone, state::idle);
+  sm.dispatch(event::dial);
+  sm.dispatch(event::answer);
+  EXPECT_TRUE(sm.in(state::connected));
+  EXPECT_TRUE(sm.in(state::talking));
+  EXPECT_FALSE(sm.in(state::on_hold));
+
+  int hang_ups = 0;
+  sm.on_transition(state::connected, event::hang_up, [&] { ++hang_ups; });
+  sm.dispatch(event::hold);
+  EXPECT_TRUE(sm.dispatch(event::hang_up));
+  EXPECT_EQ(state::idle, sm.state());
+  EXPECT_EQ(1, hang_ups);
+  EXPECT_FALSE(sm.in(state::connected));
+}
+
+TEST(state_machine_test, actions_and_guards) {
+  std::vector<std::string> log;
+  state_machine<state, event, std::string const&> sm(phone, state::idle);
+  sm.on_transition(state::idle, event::dial,
+                   [&log](std::string const& number) {
+                     log.push_back("dial " + number);
+                   });
+  sm.guard(state::idle, event::dial,
+           [](std::string const& number) { return !number.empty(); });
+
+  EXPECT_FALSE(sm.dispatch(event::dial, ""));
+  EXPECT_EQ(state::idle, sm.state());
+  EXPECT_TRUE(log.empty());
+
+  EXPECT_TRUE(sm.dispatch(event::dial, "123"));
+  EXPECT_EQ(state::dialing, sm.state());
+  EXPECT_EQ(std::vector<std::string>{"dial 123"}, log);
+}
+
+TEST(state_machine_test, throwing_action_keeps_state) {
+  state_machine<state, event> sm(phone, state::idle);
+  sm.on_transition(state::idle, event::dial,
+                   [] { throw std::runtime_error("busy"); });
+  EXPECT_THROW(sm.dispatch(event::dial), std::runtime_error);
+  EXPECT_EQ(state::idle, sm.state());
+}
@@ -1,6 +1,9 @@
 #include "function.h"
 #include <gtest/gtest.h>
 
+#include <string>
+#include <vector>
+
 TEST(function_test, default_ctor) {
   function<void()> x;
   function<void(int, int, int)> y;
@@ -172,6 +175,80 @@ TEST(function_test, small_func_with_pointer_assignment_operator_move) {
   EXPECT_TRUE(f());
 }
 
+TEST(function_test, small_func_with_pointer_swap) {
+  function<int()> f = small_func_with_pointer();
+  function<int()> g = small_func(42);
+  f.swap(g);
+  EXPECT_EQ(42, f());
+  EXPECT_TRUE(g());
+  g.swap(f);
+  EXPECT_TRUE(f());
+  EXPECT_EQ(42, g());
+}
+
+TEST(function_test, small_func_with_pointer_move_assign_to_non_empty) {
+  function<int()> f = small_func(42);
+  function<int()> g = small_func_with_pointer();
+  f = std::move(g);
+  EXPECT_TRUE(f());
+  EXPECT_FALSE(static_cast<bool>(g));
+  g = small_func(1);
+  f = std::move(g);
+  EXPECT_EQ(1, f());
+}
+
+// Target owning a function that is moved out while the holder is replaced
+struct holder {
+  int operator()() {
+    return inner() + 1;
+  }
+
+  function<int()> inner;
+};
+
+TEST(function_test, move_assign_from_own_target) {
+  function<int()> f = holder{small_func(41)};
+  f = std::move(f.target<holder>()->inner);
+  EXPECT_EQ(41, f());
+
+  // Not relocatable, goes through the move thunk
+  f = holder{small_func_with_pointer()};
+  f = std::move(f.target<holder>()->inner);
+  EXPECT_TRUE(f());
+  EXPECT_EQ(nullptr, f.target<holder>());
+}
+
+struct move_may_throw {
+  move_may_throw() = default;
+  move_may_throw(move_may_throw const&) = default;
+
+  move_may_throw(move_may_throw&&) noexcept(false) {
+    if (fail) {
+      throw std::runtime_error("move");
+    }
+  }
+
+  int operator()() const {
+    return 42;
+  }
+
+  static inline bool fail = false;
+};
+
+TEST(function_test, inline_throwing_moves_construct_throws) {
+  using inline_func_t = function<int(), inline_throwing_moves>;
+  move_may_throw target;
+  move_may_throw::fail = true;
+  EXPECT_THROW(inline_func_t{target}, std::runtime_error);
+  move_may_throw::fail = false;
+
+  inline_func_t f = target;
+  EXPECT_EQ(42, f());
+  inline_func_t g = std::move(f);
+  EXPECT_FALSE(static_cast<bool>(f));
+  EXPECT_EQ(42, g());
+}
+
 TEST(function_test, small_func_target) {
   function<int()> f = small_func(42);
   EXPECT_EQ(42, f.target<small_func>()->get_value());
@@ -379,6 +456,13 @@ TEST(function_test, argument_by_value_large) {
   non_copyable a = f(non_copyable());
 }
 
+TEST(function_test, void_discards_result) {
+  int calls = 0;
+  function<void()> f = [&calls] { return ++calls; };
+  f();
+  EXPECT_EQ(1, calls);
+}
+
 TEST(function_test, recursive_test) {
   function<int(int)> fib = [&fib](int n) -> int {
     switch (n) {
@@ -393,6 +477,30 @@ TEST(function_test, recursive_test) {
   EXPECT_EQ(55, fib(10));
 }
 
+TEST(function_test, recursive_function) {
+  recursive_function<int(int)> fib = [](auto& self, int n) {
+    return n < 2 ? n : self(n - 1) + self(n - 2);
+  };
+  EXPECT_EQ(55, fib(10));
+
+  recursive_function<int(int)> copy = fib;
+  EXPECT_EQ(55, copy(10));
+
+  recursive_function<int(int)> empty;
+  EXPECT_THROW(empty(1), bad_function_call);
+}
+
+TEST(function_test, recursive_function_target) {
+  auto factorial = [base = 1](auto& self, int n) -> int {
+    return n <= 1 ? base : n * self(n - 1);
+  };
+  recursive_function<int(int)> f = factorial;
+  EXPECT_EQ(120, f(5));
+  auto identity = [](auto&, int n) { return n; };
+  EXPECT_NE(nullptr, f.target<decltype(factorial)>());
+  EXPECT_EQ(nullptr, f.target<decltype(identity)>());
+}
+
 struct foo {
   void operator()() const {}
 };
@@ -414,6 +522,357 @@ TEST(function_test, target) {
   EXPECT_NE(nullptr, std::as_const(f).target<bar>());
 }
 
+TEST(function_test, target_type) {
+  function<void()> f;
+  EXPECT_EQ(nullptr, f.target_type());
+  f = foo();
+  EXPECT_EQ(target_type_id<foo>(), f.target_type());
+  EXPECT_NE(target_type_id<bar>(), f.target_type());
+  f = bar();
+  EXPECT_EQ(target_type_id<bar>(), f.target_type());
+  EXPECT_NE(target_type_id<foo>(), target_type_id<bar>());
+}
+
+TEST(function_test, visit) {
+  struct visitor {
+    void operator()(foo&) {
+      result = "foo";
+    }
+    void operator()(bar&) {
+      result = "bar";
+    }
+    void operator()(large_func& f) {
+      result = std::to_string(f());
+    }
+
+    std::string result;
+  };
+
+  visitor v;
+  function<void()> f = foo();
+  EXPECT_TRUE((f.visit<foo, bar>(v)));
+  EXPECT_EQ("foo", v.result);
+  f = bar();
+  EXPECT_TRUE((f.visit<foo, bar>(v)));
+  EXPECT_EQ("bar", v.result);
+  EXPECT_FALSE(f.visit<foo>(v));
+
+  function<int()> g = large_func(42);
+  EXPECT_TRUE(g.visit<large_func>(v));
+  EXPECT_EQ("42", v.result);
+  g = small_func(1);
+  EXPECT_FALSE(g.visit<large_func>(v));
+  g = {};
+  EXPECT_FALSE(g.visit<large_func>(v));
+}
+
+template <int N>
+struct numbered {
+  int operator()() const {
+    return N;
+  }
+};
+
+TEST(function_test, visit_many_candidates) {
+  auto check = [](auto target) {
+    function<int()> f = target;
+    int visited = -1;
+    auto visitor = [&visited](auto& t) { visited = t(); };
+    bool found = f.visit<numbered<0>, numbered<1>, numbered<2>, numbered<3>,
+                         numbered<4>, numbered<5>, numbered<6>, numbered<7>,
+                         numbered<8>, numbered<9>, numbered<10>,
+                         numbered<11>>(visitor);
+    return found ? visited : -1;
+  };
+  EXPECT_EQ(0, check(numbered<0>()));
+  EXPECT_EQ(7, check(numbered<7>()));
+  EXPECT_EQ(11, check(numbered<11>()));
+  EXPECT_EQ(-1, check(numbered<12>()));
+  EXPECT_EQ(-1, check(small_func(3)));
+
+  // A repeated candidate is visited once
+  function<int()> g = numbered<1>();
+  int calls = 0;
+  EXPECT_TRUE((g.visit<numbered<1>, numbered<2>, numbered<1>>(
+      [&calls](auto&) { ++calls; })));
+  EXPECT_EQ(1, calls);
+}
+
+TEST(function_test, same_name_types) {
+  // With GCC both lambdas are named main()::<lambda(int)>, they still have
+  // distinct ids
+  auto first = [](int x) { return x; };
+  auto second = [](int x) { return x + 1; };
+  function<int(int)> f = second;
+  EXPECT_NE(target_type_id<decltype(first)>(), f.target_type());
+  EXPECT_EQ(target_type_id<decltype(second)>(), f.target_type());
+
+  int visited = 0;
+  auto visitor = [&visited](auto& target) { visited = target(1); };
+  EXPECT_FALSE(f.visit<decltype(first)>(visitor));
+  EXPECT_TRUE((f.visit<decltype(first), decltype(second)>(visitor)));
+  EXPECT_EQ(2, visited);
+}
+
+// Mimics a C API taking a callback and its user data
+static int call_c_api(int (*fn)(void*, int), void* ctx, int arg) {
+  return fn(ctx, arg);
+}
+
+TEST(function_test, c_callback) {
+  function<int(int)> f = [](int x) { return x + 1; };
+  auto callback = f.c_callback();
+  EXPECT_EQ(42, call_c_api(callback.fn, callback.ctx, 41));
+  EXPECT_EQ(42, callback(41));
+
+  f = [](int x) { return x + 2; };
+  EXPECT_EQ(42, call_c_api(callback.fn, callback.ctx, 40));
+}
+
+TEST(function_test, c_callback_empty) {
+  function<int(int)> f;
+  auto callback = f.c_callback();
+  EXPECT_THROW(callback(0), bad_function_call);
+  EXPECT_THROW(std::move(f).release_c_callback()(0), bad_function_call);
+}
+
+// Small and trivially copyable, unlike a lambda with captures, which is not
+// move assignable
+struct add_to_base {
+  int operator()(int x) const {
+    return *base + x;
+  }
+
+  int const* base;
+};
+
+TEST(function_test, release_c_callback_small) {
+  static_assert(function_impl::fits_small<add_to_base> &&
+                std::is_trivially_copyable_v<add_to_base>);
+  int base = 40;
+  function<int(int)> f = add_to_base{&base};
+  auto callback = std::move(f).release_c_callback();
+  EXPECT_FALSE(static_cast<bool>(f));
+  // The target travels as the bytes of `ctx`
+  EXPECT_EQ(static_cast<void*>(&base), callback.ctx);
+  EXPECT_EQ(42, call_c_api(callback.fn, callback.ctx, 2));
+}
+
+TEST(function_test, release_c_callback_large) {
+  {
+    function<int()> f = large_func(42);
+    auto callback = std::move(f).release_c_callback();
+    EXPECT_FALSE(static_cast<bool>(f));
+    EXPECT_EQ(42, callback());
+  }
+  large_func::assert_no_instances();
+}
+
+TEST(function_test, release_c_callback_small_non_trivial) {
+  function<int()> f = small_func_with_pointer();
+  auto callback = std::move(f).release_c_callback();
+  EXPECT_FALSE(static_cast<bool>(f));
+  EXPECT_EQ(1, callback());
+}
+
+TEST(function_test, function_view) {
+  int calls = 0;
+  auto lambda = [&calls](int x) {
+    ++calls;
+    return x * 2;
+  };
+  function_view<int(int)> view = lambda;
+  EXPECT_EQ(42, view(21));
+  EXPECT_EQ(42, call_c_api(view.c_callback().fn, view.c_callback().ctx, 21));
+  EXPECT_EQ(2, calls);
+
+  function<int()> f = small_func(42);
+  function_view<int()> f_view = f;
+  EXPECT_EQ(f.c_callback().fn, f_view.c_callback().fn);
+  EXPECT_EQ(42, f_view());
+
+  function_view<int()> copy = f_view;
+  EXPECT_EQ(42, copy());
+}
+
+struct value_op {
+  using signature = int();
+
+  template <typename T>
+  static int call(T& target) {
+    return target.get_value();
+  }
+};
+
+struct add_op {
+  using signature = int(int);
+
+  template <typename T>
+  static int call(T& target, int x) {
+    return target.get_value() + x;
+  }
+};
+
+struct large_value_func {
+  int operator()() const {
+    return values[0];
+  }
+
+  int get_value() const {
+    return values[1];
+  }
+
+  int values[8];
+};
+
+TEST(function_test, ops) {
+  function<int(), value_op, add_op> f = small_func(42);
+  EXPECT_EQ(42, f());
+  EXPECT_EQ(42, f.call<value_op>());
+  EXPECT_EQ(43, f.call<add_op>(1));
+  EXPECT_NE(nullptr, f.target<small_func>());
+
+  f = large_value_func{{1, 2}};
+  EXPECT_EQ(1, f());
+  EXPECT_EQ(2, f.call<value_op>());
+  EXPECT_EQ(5, f.call<add_op>(3));
+  EXPECT_NE(nullptr, f.target<large_value_func>());
+  EXPECT_EQ(nullptr, f.target<small_func>());
+}
+
+TEST(function_test, ops_copy_move) {
+  function<int(), value_op> f = small_func(42);
+  function<int(), value_op> g = f;
+  EXPECT_EQ(42, g.call<value_op>());
+  function<int(), value_op> h = std::move(f);
+  EXPECT_EQ(42, h.call<value_op>());
+  h = large_value_func{{1, 2}};
+  std::swap(g, h);
+  EXPECT_EQ(2, g.call<value_op>());
+  EXPECT_EQ(42, h.call<value_op>());
+}
+
+TEST(function_test, ops_empty) {
+  function<int(), value_op> f;
+  EXPECT_THROW(f.call<value_op>(), bad_function_call);
+  f = small_func(42);
+  function<int(), value_op> g = std::move(f);
+  EXPECT_THROW(f.call<value_op>(), bad_function_call);
+}
+
+template <typename... Fs>
+struct overloaded : Fs... {
+  using Fs::operator()...;
+};
+
+template <typename... Fs>
+overloaded(Fs...) -> overloaded<Fs...>;
+
+TEST(function_test, multiple_signatures) {
+  int ints = 0;
+  std::string_view last;
+  function<void(int), int(std::string_view)> f =
+      overloaded{[&ints](int x) { ints += x; },
+                 [&last](std::string_view s) {
+                   last = s;
+                   return static_cast<int>(s.size());
+                 }};
+  f(40);
+  f(2);
+  EXPECT_EQ(42, ints);
+  EXPECT_EQ(3, f(std::string_view("abc")));
+  EXPECT_EQ("abc", last);
+  EXPECT_EQ(5, f.call<int(std::string_view)>("hello"));
+}
+
+TEST(function_test, multiple_signatures_copy_empty) {
+  function<int(), int(int)> f = [](auto... x) { return (42 + ... + x); };
+  function<int(), int(int)> g = f;
+  EXPECT_EQ(42, g());
+  EXPECT_EQ(43, g(1));
+
+  function<int(), int(int)> empty;
+  EXPECT_THROW(empty(), bad_function_call);
+  EXPECT_THROW(empty(1), bad_function_call);
+}
+
+struct immovable {
+  explicit immovable(int value) : value(value) {}
+  immovable(immovable const&) = delete;
+  immovable(immovable&&) = delete;
+
+  int value;
+};
+
+TEST(function_test, immovable_result) {
+  function<immovable(int)> f = [](int x) { return immovable(x); };
+  immovable result = f(42);
+  EXPECT_EQ(42, result.value);
+}
+
+struct counted_result {
+  counted_result() = default;
+
+  counted_result(counted_result const&) {
+    ++copies;
+  }
+
+  counted_result(counted_result&&) noexcept {
+    ++moves;
+  }
+
+  counted_result& operator=(counted_result const&) {
+    ++copies;
+    return *this;
+  }
+
+  counted_result& operator=(counted_result&&) noexcept {
+    ++moves;
+    return *this;
+  }
+
+  static inline int copies = 0;
+  static inline int moves = 0;
+  int payload[16];
+};
+
+TEST(function_test, result_elision) {
+  function<counted_result()> f = [] { return counted_result(); };
+  counted_result result = f();
+  EXPECT_EQ(0, counted_result::copies);
+  EXPECT_EQ(0, counted_result::moves);
+  // The result of the call is move assigned, no temporary is moved or copied
+  f.invoke_into(result);
+  EXPECT_EQ(0, counted_result::copies);
+  EXPECT_EQ(1, counted_result::moves);
+}
+
+struct fill_func {
+  std::vector<int> operator()(int n) const {
+    return std::vector<int>(n, n);
+  }
+
+  void invoke_into(std::vector<int>& out, int n) const {
+    out.assign(n, n);
+  }
+};
+
+TEST(function_test, invoke_into) {
+  function<std::vector<int>(int)> f = fill_func();
+  std::vector<int> out = f(8);
+  int const* buffer = out.data();
+  f.invoke_into(out, 4);
+  EXPECT_EQ(std::vector<int>(4, 4), out);
+  EXPECT_EQ(buffer, out.data());
+
+  f = [](int n) { return std::vector<int>(n, 1); };
+  f.invoke_into(out, 2);
+  EXPECT_EQ(std::vector<int>(2, 1), out);
+
+  f = {};
+  EXPECT_THROW(f.invoke_into(out, 1), bad_function_call);
+}
+
 int main(int argc, char* argv[]) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
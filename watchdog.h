@@ -0,0 +1,211 @@
+#pragma once
+
+#include "function.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace watchdog_impl {
+
+using clock = std::chrono::steady_clock;
+
+// Publication slot of a single thread. Only the owning thread writes the
+// payload, monitors read it under a seqlock: `seq` is odd while the payload
+// is being rewritten, so a reader that sees the same even value before and
+// after reading the payload got a consistent snapshot.
+struct slot {
+  std::atomic<std::uint64_t> seq{0};
+  std::atomic<bool> active{false};
+  std::atomic<std::int64_t> start{0};
+  std::atomic<char const*> name{nullptr};
+  std::atomic<std::size_t> name_size{0};
+
+  std::atomic<bool> in_use{false};
+  // Nesting level of watched calls, touched by the owning thread only
+  std::size_t depth{0};
+
+  void publish(bool is_active, std::string_view target) noexcept {
+    std::uint64_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    if (is_active) {
+      start.store(clock::now().time_since_epoch().count(),
+                  std::memory_order_relaxed);
+      name.store(target.data(), std::memory_order_relaxed);
+      name_size.store(target.size(), std::memory_order_relaxed);
+    }
+    active.store(is_active, std::memory_order_relaxed);
+    seq.store(s + 2, std::memory_order_release);
+  }
+};
+
+struct snapshot {
+  std::uint64_t seq;
+  std::int64_t start;
+  std::string_view name;
+};
+
+// Returns false if the slot is idle or was being rewritten
+inline bool read(slot const& s, snapshot& out) noexcept {
+  std::uint64_t before = s.seq.load(std::memory_order_acquire);
+  if (before % 2 != 0) {
+    return false;
+  }
+  bool is_active = s.active.load(std::memory_order_relaxed);
+  out.seq = before;
+  out.start = s.start.load(std::memory_order_relaxed);
+  out.name = {s.name.load(std::memory_order_relaxed),
+              s.name_size.load(std::memory_order_relaxed)};
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return is_active && s.seq.load(std::memory_order_relaxed) == before;
+}
+
+// Slots are never freed: a thread returns its slot on exit and the next new
+// thread picks it up, so monitors may keep plain pointers to them
+class registry {
+public:
+  static registry& instance() {
+    static registry result;
+    return result;
+  }
+
+  slot* acquire() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& s : slots) {
+      bool expected = false;
+      if (s->in_use.compare_exchange_strong(expected, true)) {
+        return s.get();
+      }
+    }
+    slots.push_back(std::make_unique<slot>());
+    slots.back()->in_use.store(true);
+    return slots.back().get();
+  }
+
+  void collect(std::vector<slot const*>& out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    out.clear();
+    for (auto& s : slots) {
+      out.push_back(s.get());
+    }
+  }
+
+private:
+  std::mutex mutex;
+  std::vector<std::unique_ptr<slot>> slots;
+};
+
+struct slot_handle {
+  slot_handle() : s(registry::instance().acquire()) {}
+
+  ~slot_handle() {
+    s->in_use.store(false, std::memory_order_release);
+  }
+
+  slot* s;
+};
+
+inline slot& current_slot() {
+  thread_local slot_handle handle;
+  return *handle.s;
+}
+
+struct call_guard {
+  call_guard(slot& s, std::string_view target) noexcept : s(s) {
+    if (s.depth++ == 0) {
+      s.publish(true, target);
+    }
+  }
+
+  ~call_guard() {
+    if (--s.depth == 0) {
+      s.publish(false, {});
+    }
+  }
+
+  slot& s;
+};
+} // namespace watchdog_impl
+
+// Invokes `f` while publishing its start time and target name to the calling
+// thread's slot, so that a running `watchdog` can notice a stuck handler.
+// Nested watched calls are attributed to the outermost one.
+template <typename R, typename... Args, typename... Ops, typename... Ts>
+R watched_invoke(function<R(Args...), Ops...>& f, Ts&&... args) {
+  watchdog_impl::call_guard guard(watchdog_impl::current_slot(),
+                                  f.target_name());
+  return f(std::forward<Ts>(args)...);
+}
+
+// Background thread that periodically scans all slots and reports every
+// watched call that has been running for longer than `threshold`. Each call
+// is reported at most once, from the monitor thread.
+class watchdog {
+public:
+  using reporter_t =
+      function<void(std::string_view, std::chrono::nanoseconds)>;
+
+  watchdog(std::chrono::nanoseconds threshold, reporter_t reporter)
+      : watchdog(threshold, std::move(reporter), threshold / 2) {}
+
+  watchdog(std::chrono::nanoseconds threshold, reporter_t reporter,
+           std::chrono::nanoseconds period)
+      : threshold(threshold), period(period), reporter(std::move(reporter)),
+        monitor([this] { run(); }) {}
+
+  watchdog(watchdog const&) = delete;
+  watchdog& operator=(watchdog const&) = delete;
+
+  ~watchdog() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopped = true;
+    }
+    wakeup.notify_one();
+    monitor.join();
+  }
+
+private:
+  void run() {
+    std::vector<watchdog_impl::slot const*> slots;
+    std::vector<std::uint64_t> reported;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!wakeup.wait_for(lock, period, [this] { return stopped; })) {
+      lock.unlock();
+      watchdog_impl::registry::instance().collect(slots);
+      reported.resize(slots.size(), 0);
+      std::int64_t now =
+          watchdog_impl::clock::now().time_since_epoch().count();
+      for (std::size_t i = 0; i < slots.size(); ++i) {
+        watchdog_impl::snapshot call;
+        if (!watchdog_impl::read(*slots[i], call) || reported[i] == call.seq) {
+          continue;
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            watchdog_impl::clock::duration(now - call.start));
+        if (elapsed >= threshold) {
+          reported[i] = call.seq;
+          reporter(call.name, elapsed);
+        }
+      }
+      lock.lock();
+    }
+  }
+
+  std::chrono::nanoseconds threshold;
+  std::chrono::nanoseconds period;
+  reporter_t reporter;
+
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  bool stopped{false};
+
+  std::thread monitor;
+};
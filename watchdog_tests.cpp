@@ -0,0 +1,81 @@
+#include "watchdog.h"
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace {
+struct slow_handler {
+  void operator()() const {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+};
+
+struct fast_handler {
+  void operator()() const {}
+};
+
+struct reports {
+  std::mutex mutex;
+  std::vector<std::string> names;
+
+  watchdog::reporter_t reporter() {
+    return [this](std::string_view name, std::chrono::nanoseconds) {
+      std::lock_guard<std::mutex> lock(mutex);
+      names.emplace_back(name);
+    };
+  }
+};
+} // namespace
+
+TEST(watchdog_test, target_name) {
+  function<void()> f = slow_handler();
+  EXPECT_NE(std::string_view::npos, f.target_name().find("slow_handler"));
+  EXPECT_TRUE(function<void()>().target_name().empty());
+}
+
+TEST(watchdog_test, reports_slow_call_once) {
+  reports r;
+  {
+    watchdog dog(std::chrono::milliseconds(10), r.reporter(),
+                 std::chrono::milliseconds(1));
+    function<void()> f = slow_handler();
+    watched_invoke(f);
+  }
+  ASSERT_EQ(1, r.names.size());
+  EXPECT_NE(std::string::npos, r.names[0].find("slow_handler"));
+}
+
+TEST(watchdog_test, ignores_fast_calls) {
+  reports r;
+  {
+    watchdog dog(std::chrono::milliseconds(50), r.reporter(),
+                 std::chrono::milliseconds(1));
+    function<void()> f = fast_handler();
+    for (int i = 0; i < 1000; ++i) {
+      watched_invoke(f);
+    }
+  }
+  EXPECT_TRUE(r.names.empty());
+}
+
+TEST(watchdog_test, nested_calls_attributed_to_outermost) {
+  reports r;
+  {
+    watchdog dog(std::chrono::milliseconds(10), r.reporter(),
+                 std::chrono::milliseconds(1));
+    function<void()> inner = slow_handler();
+    function<void()> outer = [&inner] { watched_invoke(inner); };
+    watched_invoke(outer);
+  }
+  ASSERT_EQ(1, r.names.size());
+  EXPECT_EQ(std::string::npos, r.names[0].find("slow_handler"));
+}
+
+TEST(watchdog_test, arguments_and_exceptions) {
+  function<int(int, int)> add = [](int a, int b) { return a + b; };
+  EXPECT_EQ(42, watched_invoke(add, 40, 2));
+
+  function<void()> empty;
+  EXPECT_THROW(watched_invoke(empty), bad_function_call);
+  EXPECT_EQ(0, watchdog_impl::current_slot().depth);
+}